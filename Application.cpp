@@ -5,6 +5,8 @@
  **********************************/
 
 #include "Application.h"
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 void handler(int sig) {
 	void *array[10];
@@ -50,8 +52,16 @@ Application::Application(char *infile) {
 	par = new Params();
 	srand (time(NULL));
 	par->setparams(infile);
+	if( par->SEED ) {
+		srand(par->SEED);
+	}
 	log = new Log(par);
-	en = new EmulNet(par);
+	udp = NULL;
+	if( par->TRANSPORT == UDP_TRANSPORT ) {
+		en = udp = new UdpNet(par);
+	} else {
+		en = new EmulNet(par);
+	}
 	// pointer to pointers of MP1Nodes
 	// EN_GPSZ is the actual number of peers (nodes)
 	// so allocating space for EN_GPSZ pointers to nodes
@@ -68,15 +78,51 @@ Application::Application(char *infile) {
 		joinaddr = getjoinaddr();
 		addressOfMemberNode = (Address *) en->ENinit(addressOfMemberNode, par->PORTNUM);
 		mp1[i] = new MP1Node(memberNode, par, en, log, addressOfMemberNode);
-		log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
+		log->LOG(mp1[i]->getMemberNode()->addr.getNodeId(), "APP");
 		delete addressOfMemberNode;
 	}
+	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+		allNodes.push_back(i);
+	}
+	for( i = 0; i < par->EN_GPSZ; i++ ) {
+		int id = mp1[i]->getMemberNode()->addr.getNodeId().getid();
+		if( id >= (int)indexOfId.size() ) {
+			indexOfId.resize(id + 1, -1);
+		}
+		indexOfId[id] = i;
+	}
+	for( i = 0; i < par->EN_GPSZ; i++ ) {
+		startTime.push_back((int)(par->STEP_RATE*i));
+	}
+
+	scenario = NULL;
+	if( !par->SCENARIO.empty() ) {
+		scenario = new Scenario(par, par->SCENARIO.c_str());
+		vector<int> heldBack = scenario->heldBack();
+		for( vector<int>::iterator id = heldBack.begin(); id != heldBack.end(); ++id ) {
+			startTime[indexOfId[*id]] = INT_MAX;
+		}
+		// each node reports its removals to its own slot of the scenario
+		log->setRemoveHook([this](NodeId observer, NodeId removed) {
+			// the observer's entry is still there, with the last heartbeat it heard
+			Member *node = mp1[indexOfId[observer.getid()]]->getMemberNode();
+			scenario->noteRemoval(observer, removed, node->memberList.heartbeat(node->findMember(removed)));
+		});
+	}
+
+	// the calling thread is one of the pool's threads
+	pool = NULL;
+	if( par->THREADS > 1 ) {
+		pool = new ThreadPool(par->THREADS);
+	}
 }
 
 /**
  * Destructor
  */
 Application::~Application() {
+	delete scenario;
+	delete pool;
 	delete log;
 	delete en;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
@@ -97,14 +143,26 @@ int Application::run()
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
+	int runningTime = par->RUNNING_TIME > 0 ? par->RUNNING_TIME : TOTAL_RUNNING_TIME;
+	srand(par->SEED ? par->SEED : time(NULL));
 
-	// As time runs along
-	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
-		// Run the membership protocol
-		mp1Run();
-		// Fail some nodes
-		fail();
+	if( par->CLOCK == WALL_CLOCK ) {
+		runWallClock(runningTime);
+	} else if( par->CLOCK == EVENT_CLOCK ) {
+		runEvents(runningTime);
+	} else {
+		// As time runs along
+		for( par->globaltime = 0; par->globaltime < runningTime; ++par->globaltime ) {
+			// Run the membership protocol
+			mp1Run(allNodes);
+			// Fail some nodes
+			fail();
+		}
+	}
+
+	if( scenario ) {
+		scenario->closePhase(runningTime - 1, upNodes(), en->ENsentMessages(), en->ENsentBytes(), en->ENcutDrops());
+		scenario->report(SCENARIO_LOG);
 	}
 
 	// Clean up
@@ -121,42 +179,367 @@ int Application::run()
  * FUNCTION NAME: mp1Run
  *
  * DESCRIPTION:	This function performs all the membership protocol functionalities
+ * 				for the given nodes, highest index first
+ * 				Nodes may be stepped on several threads, so what they log or
+ * 				send is staged and applied in node order once all of them are
+ * 				done. The result is the same for any number of threads
  */
-void Application::mp1Run() {
-	int i;
+void Application::mp1Run(const vector<int> &nodes) {
+	log->setStaging(true);
 
 	// For all the nodes in the system
-	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+	forEachNode(nodes, [this](int i) {
 		// checks if the node has been inserted (a node is inserted at time
 		// par->STEP_RATE*i) and that the node hasn't failed
-		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		if( par->getcurrtime() > startTime[i] && !(mp1[i]->getMemberNode()->bFailed) ) {
 			// Receive messages from the network and queue them
 			mp1[i]->recvLoop();
 		}
-	}
+	});
+
+	startNodes(nodes);
 
 	// For all the nodes in the system
-	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+	forEachNode(nodes, [this](int i) {
+		// checks that the node has been introduced and has not failed.
+		if( par->getcurrtime() > startTime[i] && !(mp1[i]->getMemberNode()->bFailed) ) {
+			// handle messages and send heartbeats
+			mp1[i]->nodeLoop();
+			#ifdef DEBUGLOG
+			if( (i == 0) && (par->globaltime % TIME_LOG_PERIOD == 0) ) {
+				log->LOG(mp1[i]->getMemberNode()->addr.getNodeId(), "@@time=%d", par->getcurrtime());
+			}
+			#endif
+		}
+	});
+
+	log->flushStaged();
+	log->setStaging(false);
+	en->ENtick();
+}
+
+/**
+ * FUNCTION NAME: startNodes
+ *
+ * DESCRIPTION: Introduces those of the given nodes that are due at the
+ * 				current time, one after another as this reports on stdout
+ */
+void Application::startNodes(const vector<int> &nodes) {
+	for( vector<int>::const_iterator node = nodes.begin(); node != nodes.end(); ++node ) {
+		int i = *node;
 		// checks if it is time to introduce the node into the system.
-		if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
+		if( par->getcurrtime() != startTime[i] ) {
+			continue;
+		}
+		if( mp1[i]->getMemberNode()->inited ) {
+			// a crashed node the scenario recovers, whatever reached it while
+			// it was down is lost
+			Address joinaddr = joinAddress(i);
+			en->ENdiscard(&mp1[i]->getMemberNode()->addr);
+			mp1[i]->nodeRestart(&joinaddr);
+			scenario->noteRestart(mp1[i]->getMemberNode()->addr.getNodeId().getid(), mp1[i]->getMemberNode()->heartbeat);
+			cout<<i<<"-th node restarted with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+		} else if( scenario && !(joinAddress(i) == getjoinaddr()) ) {
+			// a node the scenario has join while the introducer is down
+			Address joinaddr = joinAddress(i);
+			mp1[i]->nodeRestart(&joinaddr);
+			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
+			nodeCount += i;
+		} else {
 			// introduce the ith node into the system at time STEPRATE*i
 			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
 			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
 			nodeCount += i;
 		}
+	}
+}
 
-		// checks that the node has been introduced and has not failed.
-		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
-			// handle messages and send heartbeats
-			mp1[i]->nodeLoop();
-			#ifdef DEBUGLOG
-			if( (i == 0) && (par->globaltime % 500 == 0) ) {
-				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+/**
+ * FUNCTION NAME: forEachNode
+ *
+ * DESCRIPTION: Calls step for every node index in nodes, in order. With more
+ * 				than one thread the nodes are handed out in batches of
+ * 				NODES_PER_TASK
+ */
+void Application::forEachNode(const vector<int> &nodes, const function<void(int)> &step) {
+	int numNodes = nodes.size();
+	if( pool == NULL ) {
+		for( int n = 0; n < numNodes; n++ ) {
+			step(nodes[n]);
+		}
+		return;
+	}
+
+	int numTasks = (numNodes + NODES_PER_TASK - 1) / NODES_PER_TASK;
+	pool->run(numTasks, [numNodes, &nodes, &step](int task) {
+		int first = task * NODES_PER_TASK;
+		int last = min(first + NODES_PER_TASK, numNodes);
+		for( int n = first; n < last; n++ ) {
+			step(nodes[n]);
+		}
+	});
+}
+
+/**
+ * FUNCTION NAME: runWallClock
+ *
+ * DESCRIPTION: Runs the group on the monotonic clock instead of stepping
+ * 				every node every tick. A time unit lasts TICK_MS milliseconds.
+ * 				The process sleeps in epoll_wait until a node's socket has
+ * 				input or the earliest deadline comes up, on a single timerfd:
+ * 				a node's next heartbeat, probe or expiry, a node to introduce
+ * 				or a scheduled failure. Only the nodes with input or a due
+ * 				deadline are stepped, and what they send goes out at once
+ */
+void Application::runWallClock(int runningTime) {
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+	int timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if( epfd < 0 || timerfd < 0 ) {
+		perror("epoll");
+		exit(1);
+	}
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	// node indices tag the sockets, one past the last tags the timer
+	event.data.u32 = par->EN_GPSZ;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, timerfd, &event);
+
+	// when each node is due next, and a heap of the same times whose stale
+	// entries are skipped
+	vector<int> due(par->EN_GPSZ, INT_MAX);
+	priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> deadlines;
+	vector<bool> watched(par->EN_GPSZ, false);
+	vector<int> ready;
+	struct epoll_event events[EPOLL_BATCH];
+	struct timespec start, clock;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	auto schedule = [&](int i, int time) {
+		due[i] = time;
+		if( time != INT_MAX ) {
+			deadlines.push(make_pair(time, i));
+		}
+	};
+	// started nodes are watched from their first time unit on, until they fail
+	auto watchNodes = [&]() {
+		for( int i = 0; i < par->EN_GPSZ; i++ ) {
+			bool live = mp1[i]->getMemberNode()->inited && !mp1[i]->getMemberNode()->bFailed;
+			if( live != watched[i] ) {
+				event.data.u32 = i;
+				epoll_ctl(epfd, live ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, udp->ENsocket(&mp1[i]->getMemberNode()->addr), &event);
+				watched[i] = live;
+				schedule(i, live ? par->getcurrtime() + 1 : INT_MAX);
 			}
-			#endif
 		}
+	};
+
+	par->globaltime = 0;
+	startNodes(allNodes);
+	watchNodes();
+	while( true ) {
+		clock_gettime(CLOCK_MONOTONIC, &clock);
+		long elapsedMs = (clock.tv_sec - start.tv_sec) * 1000L + (clock.tv_nsec - start.tv_nsec) / 1000000L;
+		int now = (int)min((long)runningTime, elapsedMs / par->TICK_MS);
+
+		// the time units that went by end one after another
+		while( par->globaltime < now ) {
+			fail();
+			en->ENtick();
+			par->globaltime++;
+			startNodes(allNodes);
+			watchNodes();
+		}
+		if( par->globaltime >= runningTime ) {
+			break;
+		}
+
+		// step the nodes with input or a deadline that came up, from the
+		// highest index down as the tick loop does
+		while( !deadlines.empty() && deadlines.top().first <= now ) {
+			if( due[deadlines.top().second] == deadlines.top().first ) {
+				ready.push_back(deadlines.top().second);
+			}
+			deadlines.pop();
+		}
+		sort(ready.begin(), ready.end(), greater<int>());
+		ready.erase(unique(ready.begin(), ready.end()), ready.end());
+		for( vector<int>::iterator i = ready.begin(); i != ready.end(); ++i ) {
+			if( !watched[*i] ) {
+				continue;
+			}
+			mp1[*i]->recvLoop();
+			mp1[*i]->nodeLoop();
+			udp->ENflush(&mp1[*i]->getMemberNode()->addr);
+			// nothing more comes due within the time unit just handled
+			schedule(*i, max(mp1[*i]->nextDeadline(), now + 1));
+		}
+		ready.clear();
 
+		// sleep until there is input or the earliest deadline
+		while( !deadlines.empty() && due[deadlines.top().second] != deadlines.top().first ) {
+			deadlines.pop();
+		}
+		long wake = min(runningTime, nextScheduledTime());
+		if( !deadlines.empty() ) {
+			wake = min(wake, (long)deadlines.top().first);
+		}
+		long wakeMs = wake * par->TICK_MS;
+		struct itimerspec timer;
+		memset(&timer, 0, sizeof(timer));
+		timer.it_value.tv_sec = start.tv_sec + wakeMs / 1000;
+		timer.it_value.tv_nsec = start.tv_nsec + (wakeMs % 1000) * 1000000L;
+		if( timer.it_value.tv_nsec >= 1000000000L ) {
+			timer.it_value.tv_sec++;
+			timer.it_value.tv_nsec -= 1000000000L;
+		}
+		timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &timer, NULL);
+
+		int numEvents = epoll_wait(epfd, events, EPOLL_BATCH, -1);
+		for( int e = 0; e < numEvents; e++ ) {
+			if( events[e].data.u32 == (unsigned int)par->EN_GPSZ ) {
+				uint64_t expirations;
+				if( read(timerfd, &expirations, sizeof(expirations)) < 0 ) {
+					// a spurious wakeup, the clock is read again anyway
+				}
+			} else {
+				ready.push_back(events[e].data.u32);
+			}
+		}
 	}
+
+	close(timerfd);
+	close(epfd);
+}
+
+/**
+ * FUNCTION NAME: runEvents
+ *
+ * DESCRIPTION: Runs the simulation as a sequence of events instead of
+ * 				stepping every node every time unit. A timing wheel holds when
+ * 				each node is due next: when it is introduced, when its next
+ * 				heartbeat, probe or expiry comes up, and the time unit after a
+ * 				message reached its empty inbox. Time jumps straight to the
+ * 				earliest of those, of the times fail() acts and of the time
+ * 				units at whose end delayed messages arrive. Only the due
+ * 				nodes are stepped, in the order of the tick loop, and a node
+ * 				stepped with nothing to do does nothing, so dbg.log,
+ * 				msgcount.log and the standard output are those of the tick loop
+ */
+void Application::runEvents(int runningTime) {
+	// the wheel runs one time unit ahead, as a timer armed now fires at the
+	// earliest on the next advance
+	TimerWheel wheel(0);
+	// when each node is due next and its timer, -1 while it has none
+	vector<int> due(par->EN_GPSZ, INT_MAX);
+	vector<int> timers(par->EN_GPSZ, -1);
+	vector<long long> expired;
+	vector<int> ready;
+
+	// the earliest reason to step a node wins
+	auto schedule = [&](int i, int time) {
+		if( time >= due[i] ) {
+			return;
+		}
+		due[i] = time;
+		if( timers[i] >= 0 ) {
+			wheel.rearm(timers[i], time + 1);
+		} else {
+			timers[i] = wheel.arm(time + 1, i);
+		}
+	};
+	for( int i = 0; i < par->EN_GPSZ; i++ ) {
+		schedule(i, startTime[i]);
+	}
+
+	par->globaltime = 0;
+	while( par->globaltime < runningTime ) {
+		int now = par->getcurrtime();
+		expired.clear();
+		wheel.advance(now + 1, expired);
+		for( vector<long long>::iterator i = expired.begin(); i != expired.end(); ++i ) {
+			ready.push_back(*i);
+			due[*i] = INT_MAX;
+			timers[*i] = -1;
+		}
+		#ifdef DEBUGLOG
+		// the first node logs the time every TIME_LOG_PERIOD
+		if( now % TIME_LOG_PERIOD == 0 ) {
+			ready.push_back(0);
+		}
+		#endif
+
+		// a time unit in which no node is stepped sends and logs nothing, but
+		// the network still hands over the copies in flight that are due
+		if( !ready.empty() || en->ENnextArrival() == now ) {
+			sort(ready.begin(), ready.end(), greater<int>());
+			ready.erase(unique(ready.begin(), ready.end()), ready.end());
+			mp1Run(ready);
+		}
+		fail();
+
+		// nothing more comes due within the time unit just handled
+		for( vector<int>::iterator i = ready.begin(); i != ready.end(); ++i ) {
+			schedule(*i, max(mp1[*i]->nextDeadline(), now + 1));
+		}
+		// nodes the scenario recovered or let join are introduced next
+		for( vector<int>::iterator i = rescheduled.begin(); i != rescheduled.end(); ++i ) {
+			schedule(*i, startTime[*i]);
+		}
+		rescheduled.clear();
+		// receivers drain what was delivered in the next time unit
+		vector<int> &delivered = en->ENdelivered();
+		for( vector<int>::iterator id = delivered.begin(); id != delivered.end(); ++id ) {
+			schedule(indexOfId[*id], now + 1);
+		}
+		delivered.clear();
+		ready.clear();
+
+		// the wheel's next deadline may be early for timers far out, which
+		// only costs a time unit with nothing to do
+		long next = min(runningTime, nextFailTime());
+		next = min(next, wheel.nextDeadline() - 1);
+		next = min(next, (long)en->ENnextArrival());
+		#ifdef DEBUGLOG
+		next = min(next, (long)(now / TIME_LOG_PERIOD + 1) * TIME_LOG_PERIOD);
+		#endif
+		par->globaltime = next;
+	}
+}
+
+/**
+ * FUNCTION NAME: nextScheduledTime
+ *
+ * DESCRIPTION: The next time after the current one at which a node is
+ * 				introduced or fail() acts
+ */
+int Application::nextScheduledTime() {
+	int next = nextFailTime();
+	for( int i = 0; i < par->EN_GPSZ; i++ ) {
+		if( startTime[i] > par->getcurrtime() ) {
+			next = min(next, startTime[i]);
+		}
+	}
+	return next;
+}
+
+/**
+ * FUNCTION NAME: nextFailTime
+ *
+ * DESCRIPTION: The next time after the current one at which fail() acts
+ */
+int Application::nextFailTime() {
+	if( scenario ) {
+		return scenario->nextTime();
+	}
+	int next = INT_MAX;
+	int times[] = {DROP_START_TIME, FAIL_TIME, DROP_END_TIME};
+	for( unsigned int i = 0; i < sizeof(times) / sizeof(times[0]); i++ ) {
+		if( times[i] > par->getcurrtime() ) {
+			next = min(next, times[i]);
+		}
+	}
+	return next;
 }
 
 /**
@@ -169,37 +552,178 @@ void Application::mp1Run() {
 void Application::fail() {
 	int i, removed;
 
+	// a scenario takes the place of the built-in failures and drops
+	if( scenario ) {
+		applyScenario();
+		return;
+	}
+
 	// fail half the members at time t=100
-	if( par->DROP_MSG && par->getcurrtime() == 50 ) {
+	if( par->DROP_MSG && par->getcurrtime() == DROP_START_TIME ) {
 		par->dropmsg = 1;
 	}
 
-	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
+	if( par->SINGLE_FAILURE && par->getcurrtime() == FAIL_TIME ) {
 		// drop random node
 		removed = (rand() % par->EN_GPSZ);
 		#ifdef DEBUGLOG
-		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
+		log->LOG(mp1[removed]->getMemberNode()->addr.getNodeId(), "Node failed at time=%d", par->getcurrtime());
 		#endif
 		mp1[removed]->getMemberNode()->bFailed = true;
 	}
-	else if( par->getcurrtime() == 100 ) {
+	else if( par->getcurrtime() == FAIL_TIME ) {
 		// random position in first half of list
 		removed = rand() % par->EN_GPSZ/2;
 		// fail half of the nodes
 		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
 			#ifdef DEBUGLOG
-			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
+			log->LOG(mp1[i]->getMemberNode()->addr.getNodeId(), "Node failed at time = %d", par->getcurrtime());
 			#endif
 			mp1[i]->getMemberNode()->bFailed = true;
 		}
 	}
 
-	if( par->DROP_MSG && par->getcurrtime() == 300) {
+	if( par->DROP_MSG && par->getcurrtime() == DROP_END_TIME) {
 		par->dropmsg=0;
 	}
 
 }
 
+/**
+ * FUNCTION NAME: applyScenario
+ *
+ * DESCRIPTION: Applies the scenario events due at the current time, at its
+ * 				end like the built-in failures. Recovered and joining nodes
+ * 				are introduced in the next time unit. What the group sent up
+ * 				to now is reported as one phase
+ */
+void Application::applyScenario() {
+	int now = par->getcurrtime();
+	if( scenario->nextTime() > now ) {
+		return;
+	}
+	rescheduled.clear();
+	scenario->closePhase(now, upNodes(), en->ENsentMessages(), en->ENsentBytes(), en->ENcutDrops());
+
+	ScenarioEvent event;
+	while( scenario->takeDue(now, event) ) {
+		vector<int> nodes;
+		vector<int> ids;
+		switch( event.action ) {
+		case CRASH_ACTION:
+			nodes = pickNodes(event.nodes, [this](int i) {
+				return mp1[i]->getMemberNode()->inited && !mp1[i]->getMemberNode()->bFailed;
+			});
+			for( vector<int>::iterator i = nodes.begin(); i != nodes.end(); ++i ) {
+				#ifdef DEBUGLOG
+				log->LOG(mp1[*i]->getMemberNode()->addr.getNodeId(), "Node failed at time=%d", now);
+				#endif
+				mp1[*i]->getMemberNode()->bFailed = true;
+				ids.push_back(mp1[*i]->getMemberNode()->addr.getNodeId().getid());
+			}
+			scenario->noteCrash(now, ids, upNodes());
+			break;
+		case RECOVER_ACTION:
+			nodes = pickNodes(event.nodes, [this, now](int i) {
+				return mp1[i]->getMemberNode()->inited && mp1[i]->getMemberNode()->bFailed && startTime[i] <= now;
+			});
+			for( vector<int>::iterator i = nodes.begin(); i != nodes.end(); ++i ) {
+				startTime[*i] = now + 1;
+				rescheduled.push_back(*i);
+			}
+			break;
+		case JOIN_ACTION:
+			nodes = pickNodes(event.nodes, [this](int i) {
+				return !mp1[i]->getMemberNode()->inited && startTime[i] == INT_MAX;
+			});
+			for( vector<int>::iterator i = nodes.begin(); i != nodes.end(); ++i ) {
+				startTime[*i] = now + 1;
+				rescheduled.push_back(*i);
+			}
+			break;
+		case CUT_ACTION:
+			en->ENcut(event.nodes.ids, event.others.ids);
+			break;
+		case HEAL_ACTION:
+			if( event.nodes.ids.empty() ) {
+				en->ENhealAll();
+			} else {
+				en->ENheal(event.nodes.ids, event.others.ids);
+			}
+			break;
+		case DROP_ACTION:
+			par->MSG_DROP_PROB = event.dropProb;
+			par->dropmsg = event.dropProb > 0;
+			break;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: pickNodes
+ *
+ * DESCRIPTION: Indices of the nodes an event applies to, in increasing order:
+ * 				those listed that are eligible, or as many random eligible
+ * 				ones as asked for, or all of them if there are fewer
+ */
+vector<int> Application::pickNodes(const ScenarioNodes &nodes, const function<bool(int)> &eligible) {
+	vector<int> picked;
+	if( nodes.random == 0 ) {
+		for( vector<int>::const_iterator id = nodes.ids.begin(); id != nodes.ids.end(); ++id ) {
+			if( eligible(indexOfId[*id]) ) {
+				picked.push_back(indexOfId[*id]);
+			}
+		}
+	} else {
+		for( int i = 0; i < par->EN_GPSZ; i++ ) {
+			if( eligible(i) ) {
+				picked.push_back(i);
+			}
+		}
+		// the first ones of a partial shuffle
+		int count = min(nodes.random, (int)picked.size());
+		for( int k = 0; k < count; k++ ) {
+			swap(picked[k], picked[k + rand() % (picked.size() - k)]);
+		}
+		picked.resize(count);
+	}
+	sort(picked.begin(), picked.end());
+	picked.erase(unique(picked.begin(), picked.end()), picked.end());
+	return picked;
+}
+
+/**
+ * FUNCTION NAME: upNodes
+ *
+ * DESCRIPTION: Number of nodes introduced and not failed
+ */
+int Application::upNodes() {
+	int up = 0;
+	for( int i = 0; i < par->EN_GPSZ; i++ ) {
+		if( mp1[i]->getMemberNode()->inited && !mp1[i]->getMemberNode()->bFailed ) {
+			up++;
+		}
+	}
+	return up;
+}
+
+/**
+ * FUNCTION NAME: joinAddress
+ *
+ * DESCRIPTION: The member node i joins the group through: the first node in
+ * 				the group that is up, which is the introducer while it is. With
+ * 				no such node, node i itself, so that it starts the group over
+ */
+Address Application::joinAddress(int i) {
+	for( int j = 0; j < par->EN_GPSZ; j++ ) {
+		Member *node = mp1[j]->getMemberNode();
+		if( j != i && node->inited && !node->bFailed && node->inGroup ) {
+			return node->addr;
+		}
+	}
+	return mp1[i]->getMemberNode()->addr;
+}
+
 /**
  * FUNCTION NAME: getjoinaddr
  *
@@ -13,7 +13,10 @@
 #include "Params.h"
 #include "Member.h"
 #include "EmulNet.h"
+#include "UdpNet.h"
 #include "Queue.h"
+#include "ThreadPool.h"
+#include "Scenario.h"
 
 /**
  * global variables
@@ -25,6 +28,17 @@ int nodeCount = 0;
  */
 #define ARGS_COUNT 2
 #define TOTAL_RUNNING_TIME 700
+// nodes a thread steps before it takes more work
+#define NODES_PER_TASK 64
+// times at which fail() starts dropping messages, fails nodes and stops
+// dropping messages
+#define DROP_START_TIME 50
+#define FAIL_TIME 100
+#define DROP_END_TIME 300
+// events taken from epoll per wait with the wall clock
+#define EPOLL_BATCH 64
+// time units between the @@time lines of the first node
+#define TIME_LOG_PERIOD 500
 
 /**
  * CLASS NAME: Application
@@ -37,17 +51,42 @@ private:
 	// Coordinator Node
 	char JOINADDR[30];
 	EmulNet *en;
+	// the same network when TRANSPORT is udp, NULL otherwise
+	UdpNet *udp;
   Log *log;
   // pointer to a pointer to a MP1Node
 	MP1Node **mp1;
 	Params *par;
+	// steps the nodes on THREADS threads, NULL when there is only one
+	ThreadPool *pool;
+	// every node index from the highest down, the order nodes are stepped in
+	vector<int> allNodes;
+	// node index of each network id
+	vector<int> indexOfId;
+	// time unit each node is introduced at, or restarted at after a crash.
+	// INT_MAX while a node the scenario lets join later waits
+	vector<int> startTime;
+	// the timed events of SCENARIO, NULL for the built-in failures
+	Scenario *scenario;
+	// nodes whose start time the scenario set since the caller last looked
+	vector<int> rescheduled;
 public:
 	Application(char *);
 	virtual ~Application();
 	Address getjoinaddr();
 	int run();
-	void mp1Run();
+	void mp1Run(const vector<int> &nodes);
+	void startNodes(const vector<int> &nodes);
+	void forEachNode(const vector<int> &nodes, const function<void(int)> &step);
+	void runWallClock(int runningTime);
+	void runEvents(int runningTime);
+	int nextScheduledTime();
+	int nextFailTime();
 	void fail();
+	void applyScenario();
+	vector<int> pickNodes(const ScenarioNodes &nodes, const function<bool(int)> &eligible);
+	int upNodes();
+	Address joinAddress(int i);
 };
 
 #endif /* _APPLICATION_H__ */
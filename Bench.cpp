@@ -0,0 +1,281 @@
+/**********************************
+ * FILE NAME: Bench.cpp
+ *
+ * DESCRIPTION: Macro benchmark driver. Runs Application over a grid of group
+ * 				sizes, drop probabilities and failure modes and prints one CSV
+ * 				row per run
+ **********************************/
+
+#include "stdincludes.h"
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+/*
+ * Macros
+ */
+#define BENCH_DIR "bench.d"
+#define DEFAULT_SEED 1
+// time unit at which Application fails nodes
+#define FAIL_TIME 100
+
+/**
+ * STRUCT NAME: BenchRun
+ *
+ * DESCRIPTION: One point of the grid and what was measured for it
+ */
+struct BenchRun {
+	int nodes;
+	double dropProb;
+	bool singleFailure;
+	// measured
+	double wallSeconds;
+	long maxRssKb;
+	int ticks;
+	long messages;
+	long bytes;
+	long droppedFull;
+	int convergedAt;
+	long detected;
+	long expected;
+	long falseRemovals;
+	vector<int> latencies;
+};
+
+/**
+ * FUNCTION NAME: splitList
+ *
+ * DESCRIPTION: Splits a comma separated command line value
+ */
+vector<string> splitList(const char *list) {
+	vector<string> items;
+	string item;
+	for ( const char *c = list; ; c++ ) {
+		if ( *c == ',' || *c == 0 ) {
+			if ( !item.empty() ) {
+				items.push_back(item);
+			}
+			item.clear();
+			if ( *c == 0 ) {
+				break;
+			}
+		}
+		else {
+			item += *c;
+		}
+	}
+	return items;
+}
+
+/**
+ * FUNCTION NAME: runApplication
+ *
+ * DESCRIPTION: Runs ./Application on the config file in dir, measuring its
+ * 				wall time and peak resident set size
+ */
+bool runApplication(const string &dir, BenchRun &run) {
+	struct timeval start, end;
+	struct rusage usage;
+	int status;
+
+	gettimeofday(&start, NULL);
+	pid_t pid = fork();
+	if ( pid < 0 ) {
+		return false;
+	}
+	if ( pid == 0 ) {
+		// the simulator writes its logs to the working directory
+		if ( chdir(dir.c_str()) != 0 ) {
+			_exit(127);
+		}
+		int devnull = open("/dev/null", O_WRONLY);
+		dup2(devnull, 1);
+		execl("../../Application", "Application", "bench.conf", (char *)NULL);
+		_exit(127);
+	}
+	if ( wait4(pid, &status, 0, &usage) != pid ) {
+		return false;
+	}
+	gettimeofday(&end, NULL);
+
+	run.wallSeconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+	run.maxRssKb = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * FUNCTION NAME: readLog
+ *
+ * DESCRIPTION: Works out convergence and detection from dbg.log. The group
+ * 				has converged once every node has logged every node joining.
+ * 				A removal is a detection when a node that is up removes a
+ * 				failed node after it failed, and a false removal when the
+ * 				removed node is up. Only the first detection of a failed node
+ * 				by each observer counts
+ */
+void readLog(const string &dir, BenchRun &run) {
+	ifstream in((dir + "/dbg.log").c_str());
+	string line;
+	unordered_map<string, int> failed;
+	vector<pair<string, string> > removals;
+	vector<int> removalTimes;
+	// distinct observer/subject pairs logged as joined
+	unordered_map<string, bool> joined;
+	long fullView = (long)run.nodes * run.nodes;
+
+	run.convergedAt = -1;
+	while ( getline(in, line) ) {
+		char observer[64], subject[64];
+		int at, time;
+		if ( line.find("Node failed at time") != string::npos ) {
+			if ( sscanf(line.c_str(), " %63s [%d]", observer, &at) == 2 ) {
+				failed[observer] = at;
+			}
+		}
+		else if ( sscanf(line.c_str(), " %63s [%d] Node %63s joined at time %d", observer, &at, subject, &time) == 4 ) {
+			joined[string(observer) + " " + subject] = true;
+			if ( run.convergedAt < 0 && (long)joined.size() == fullView ) {
+				run.convergedAt = time;
+			}
+		}
+		else if ( sscanf(line.c_str(), " %63s [%d] Node %63s removed at time %d", observer, &at, subject, &time) == 4 ) {
+			removals.push_back(make_pair(string(observer), string(subject)));
+			removalTimes.push_back(time);
+		}
+	}
+
+	run.detected = 0;
+	run.falseRemovals = 0;
+	unordered_map<string, bool> seen;
+	for ( size_t i = 0; i < removals.size(); i++ ) {
+		// nodes fail at the end of the time unit, after that unit's removals
+		unordered_map<string, int>::iterator failure = failed.find(removals[i].second);
+		if ( failure == failed.end() || removalTimes[i] <= failure->second ) {
+			run.falseRemovals++;
+		}
+		else if ( failed.count(removals[i].first) == 0 ) {
+			string pairKey = removals[i].first + " " + removals[i].second;
+			if ( !seen[pairKey] ) {
+				seen[pairKey] = true;
+				run.detected++;
+				run.latencies.push_back(removalTimes[i] - failed[removals[i].second]);
+			}
+		}
+	}
+	sort(run.latencies.begin(), run.latencies.end());
+	run.expected = (long)failed.size() * (run.nodes - failed.size());
+}
+
+/**
+ * FUNCTION NAME: readMessageCount
+ *
+ * DESCRIPTION: Total messages and bytes sent by the group, and the messages
+ * 				dropped on a full buffer, from msgcount.log
+ */
+void readMessageCount(const string &dir, BenchRun &run) {
+	ifstream in((dir + "/msgcount.log").c_str());
+	string line;
+	long recv = 0;
+	run.messages = 0;
+	run.bytes = 0;
+	run.droppedFull = 0;
+	while ( getline(in, line) ) {
+		sscanf(line.c_str(), "group sent_total %ld recv_total %ld", &run.messages, &recv);
+		sscanf(line.c_str(), "group sent_bytes %ld", &run.bytes);
+		sscanf(line.c_str(), "group dropped_full %ld", &run.droppedFull);
+	}
+}
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: Nearest rank percentile of sorted values, -1 when empty
+ */
+int percentile(const vector<int> &sorted, double q) {
+	if ( sorted.empty() ) {
+		return -1;
+	}
+	size_t rank = (size_t)ceil(q * sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Usage: Bench [-n sizes] [-d drop probabilities]
+ * 				[-f single,multi] [-s seed] [-t ticks] [-x "KEY: value"]...
+ * 				Lists are comma separated. Extra -x lines are appended to
+ * 				every config
+ */
+int main(int argc, char *argv[]) {
+	vector<string> sizes = splitList("10,50,100");
+	vector<string> drops = splitList("0,0.1");
+	vector<string> failures = splitList("single,multi");
+	vector<string> extra;
+	int seed = DEFAULT_SEED;
+	int ticks = 700;
+
+	for ( int i = 1; i + 1 < argc; i += 2 ) {
+		if ( strcmp(argv[i], "-n") == 0 ) {
+			sizes = splitList(argv[i + 1]);
+		} else if ( strcmp(argv[i], "-d") == 0 ) {
+			drops = splitList(argv[i + 1]);
+		} else if ( strcmp(argv[i], "-f") == 0 ) {
+			failures = splitList(argv[i + 1]);
+		} else if ( strcmp(argv[i], "-s") == 0 ) {
+			seed = atoi(argv[i + 1]);
+		} else if ( strcmp(argv[i], "-t") == 0 ) {
+			ticks = atoi(argv[i + 1]);
+		} else if ( strcmp(argv[i], "-x") == 0 ) {
+			extra.push_back(argv[i + 1]);
+		} else {
+			fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+			return 1;
+		}
+	}
+
+	mkdir(BENCH_DIR, 0755);
+	printf("nodes,drop_prob,failure,seed,ticks,wall_s,ticks_per_s,msgs,msgs_per_s,bytes,dropped_full,max_rss_kb,converged_at,detected,expected,false_removals,detect_p50,detect_p90,detect_p99,detect_max\n");
+	fflush(stdout);
+
+	for ( size_t n = 0; n < sizes.size(); n++ ) {
+		for ( size_t d = 0; d < drops.size(); d++ ) {
+			for ( size_t f = 0; f < failures.size(); f++ ) {
+				BenchRun run;
+				run.nodes = atoi(sizes[n].c_str());
+				run.dropProb = atof(drops[d].c_str());
+				run.singleFailure = (failures[f] == "single");
+				run.ticks = ticks;
+
+				string dir = string(BENCH_DIR) + "/n" + sizes[n] + "-d" + drops[d] + "-" + failures[f];
+				mkdir(dir.c_str(), 0755);
+				FILE *conf = fopen((dir + "/bench.conf").c_str(), "w");
+				fprintf(conf, "MAX_NNB: %d\nSINGLE_FAILURE: %d\nDROP_MSG: %d\nMSG_DROP_PROB: %s\n", run.nodes, run.singleFailure ? 1 : 0, run.dropProb > 0 ? 1 : 0, drops[d].c_str());
+				// an unbounded buffer, so that the grid measures the protocol
+				// rather than a saturated network. -x can bound it again
+				fprintf(conf, "SEED: %d\nRUNNING_TIME: %d\nEN_BUFFSIZE: 0\n", seed, ticks);
+				for ( size_t x = 0; x < extra.size(); x++ ) {
+					fprintf(conf, "%s\n", extra[x].c_str());
+				}
+				fclose(conf);
+
+				if ( !runApplication(dir, run) ) {
+					fprintf(stderr, "Application failed in %s.\n", dir.c_str());
+					return 1;
+				}
+				readMessageCount(dir, run);
+				readLog(dir, run);
+
+				printf("%d,%s,%s,%d,%d,%.3f,%.1f,%ld,%.0f,%ld,%ld,%ld,%d,%ld,%ld,%ld,%d,%d,%d,%d\n",
+					run.nodes, drops[d].c_str(), failures[f].c_str(), seed, ticks,
+					run.wallSeconds, ticks / run.wallSeconds, run.messages, run.messages / run.wallSeconds,
+					run.bytes, run.droppedFull, run.maxRssKb, run.convergedAt, run.detected, run.expected, run.falseRemovals,
+					percentile(run.latencies, 0.5), percentile(run.latencies, 0.9),
+					percentile(run.latencies, 0.99), run.latencies.empty() ? -1 : run.latencies.back());
+				fflush(stdout);
+			}
+		}
+	}
+	return 0;
+}
@@ -12,19 +12,25 @@
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	// default the number of messages sent and received from each node at each
-	// time point to 0
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
+	// message counters grow with the node ids that show up, and the log file
+	// is opened when the first tick is flushed
+	countFile = NULL;
+	full_drops = 0;
+	sent_bytes = 0;
+	sent_messages = 0;
+	cut_drops = 0;
+	// a message can be at most the longest delay plus one time units away
+	// from arriving
+	int maxDelay = max(par->LINK_DELAY + par->LINK_JITTER, par->ZONE_DELAY + par->ZONE_JITTER);
+	if ( maxDelay > 0 ) {
+		inflight.resize(maxDelay + 1);
 	}
+	numInflight = 0;
+	delaySeed = par->SEED ? par->SEED : time(NULL);
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -32,15 +38,23 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->sent_totals = anotherEmulNet.sent_totals;
+	this->recv_totals = anotherEmulNet.recv_totals;
+	this->countFile = anotherEmulNet.countFile;
+	this->full_drops = anotherEmulNet.full_drops;
+	this->sent_bytes = anotherEmulNet.sent_bytes;
+	this->stage = anotherEmulNet.stage;
+	this->delivered = anotherEmulNet.delivered;
+	this->inflight = anotherEmulNet.inflight;
+	this->numInflight = anotherEmulNet.numInflight;
+	this->delaySeed = anotherEmulNet.delaySeed;
+	this->sent_messages = anotherEmulNet.sent_messages;
+	this->cuts = anotherEmulNet.cuts;
+	this->cut_drops = anotherEmulNet.cut_drops;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -48,15 +62,23 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->sent_msgs = anotherEmulNet.sent_msgs;
+	this->recv_msgs = anotherEmulNet.recv_msgs;
+	this->sent_totals = anotherEmulNet.sent_totals;
+	this->recv_totals = anotherEmulNet.recv_totals;
+	this->countFile = anotherEmulNet.countFile;
+	this->full_drops = anotherEmulNet.full_drops;
+	this->sent_bytes = anotherEmulNet.sent_bytes;
+	this->stage = anotherEmulNet.stage;
+	this->delivered = anotherEmulNet.delivered;
+	this->inflight = anotherEmulNet.inflight;
+	this->numInflight = anotherEmulNet.numInflight;
+	this->delaySeed = anotherEmulNet.delaySeed;
+	this->sent_messages = anotherEmulNet.sent_messages;
+	this->cuts = anotherEmulNet.cuts;
+	this->cut_drops = anotherEmulNet.cut_drops;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -75,68 +97,307 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
 	*(int *)(myaddr->addr) = emulnet.nextid++;
   *(short *)(&myaddr->addr[4]) = 0;
+	// give the node its stage and counters now, so stepping nodes in parallel
+	// never has to grow them
+	int id = *(int *)(myaddr->addr);
+	stage.resize(id + 1);
+	stage[id].drained = 0;
+	ENcount(id, 0, 0);
 	return myaddr;
 }
 
 /**
- * FUNCTION NAME: ENsend
- *
- * DESCRIPTION: EmulNet send function
+ * FUNCTION NAME: ENdrop
  *
- * PARAMETERS:
- *   myaddr: a pointer to the address from which the message was sent
- *   toaddr: a pointer to the address to which the message is sent
- *   data: a pointer to the data being sent
- *   size: the size of the data being sent
- *
- * RETURNS:
- * size
+ * DESCRIPTION: Decides whether one copy of a message of the given size is
+ * 				lost because it is too large or to MSG_DROP_PROB. Each copy
+ * 				gets its own drop decision
  */
-int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
-  // en_msg struct which has a int for size and Address fields to and from
-	en_msg *em;
-	static char temp[2048];
+bool EmulNet::ENdrop(int size) {
 	int sendmsg = rand() % 100;
 
-  // if the buffer size is exceeded or the message is too large or the drop
-	// probability is above sendmsg, do nothing
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
-		return 0;
+  // if the message is too large or the drop probability is above sendmsg,
+	// do nothing
+	return (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100));
+}
+
+/**
+ * FUNCTION NAME: ENaccept
+ *
+ * DESCRIPTION: Decides whether the network takes one more copy of a message
+ * 				of the given size for the inbox box
+ */
+bool EmulNet::ENaccept(int size, vector<en_msg *> &box) {
+	if( ENdrop(size) ) {
+		return false;
 	}
+	// a capacity of 0 leaves the network or the inbox unbounded
+	if( (par->EN_BUFFSIZE > 0 && emulnet.currbuffsize >= par->EN_BUFFSIZE) || (par->EN_INBOXSIZE > 0 && (int)box.size() >= par->EN_INBOXSIZE) ) {
+		full_drops++;
+		return false;
+	}
+	return true;
+}
 
-  // allocate enough space for an en_msg and size
+/**
+ * FUNCTION NAME: ENframe
+ *
+ * DESCRIPTION: Copies a message into a pooled frame that no inbox holds yet
+ */
+en_msg *EmulNet::ENframe(NodeId from, char *data, int size) {
+  // take a pooled frame with enough space for an en_msg and size
 	// assign the size variable to the em size parameter
 	// so em points to an em object and em+1 points to a memory location
 	// of size bytes where the data will be stored
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
+	en_msg *em = (en_msg *)pool.acquire(sizeof(en_msg) + size);
 	em->size = size;
+	em->refcount = 0;
 
-  // copy myaddr and toaddr to the from and to fields of em respectively
-	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
-	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
+	em->from = from;
 	// copy the data to the next spot after em
 	// we allocated space for an en_msg + size space above so we are copying
 	// data into that extra space after en_msg
 	memcpy(em + 1, data, size);
+	return em;
+}
+
+/**
+ * FUNCTION NAME: ENqueue
+ *
+ * DESCRIPTION: Appends a reference to the frame to the destination's inbox
+ */
+void EmulNet::ENqueue(en_msg *em, NodeId from, vector<en_msg *> &box) {
+	// append straight into the destination's inbox
+	box.push_back(em);
+	em->refcount++;
+	emulnet.currbuffsize++;
+
+  // increment the sent message count for the sending node and current time
+	ENcount(from.getid(), 1, 0);
+	sent_messages++;
+	sent_bytes += em->size;
+}
+
+/**
+ * FUNCTION NAME: ENdelay
+ *
+ * DESCRIPTION: Draws the time units one copy spends in flight between two
+ * 				nodes beyond the tick it is sent in. Node ids are split into
+ * 				ZONES blocks of consecutive ids, and links between blocks
+ * 				use ZONE_DELAY and ZONE_JITTER
+ */
+int EmulNet::ENdelay(NodeId from, NodeId to) {
+	int delay = par->LINK_DELAY;
+	int jitter = par->LINK_JITTER;
+	if ( par->ZONES > 1 ) {
+		int fromZone = min(par->ZONES - 1, (from.getid() - 1) * par->ZONES / par->EN_GPSZ);
+		int toZone = min(par->ZONES - 1, (to.getid() - 1) * par->ZONES / par->EN_GPSZ);
+		if ( fromZone != toZone ) {
+			delay = par->ZONE_DELAY;
+			jitter = par->ZONE_JITTER;
+		}
+	}
+	if ( jitter > 0 ) {
+		delay += rand_r(&delaySeed) % (jitter + 1);
+	}
+	return delay;
+}
+
+/**
+ * FUNCTION NAME: ENlaunch
+ *
+ * DESCRIPTION: Puts a reference to the frame in flight to one destination.
+ * 				It is counted as sent now and reaches the inbox at the end of
+ * 				the time unit delay units from now. Copies in flight count
+ * 				towards EN_BUFFSIZE
+ */
+void EmulNet::ENlaunch(en_msg *em, NodeId from, NodeId to, int delay) {
+	en_flight flight;
+	flight.em = em;
+	flight.to = to;
+	inflight[(par->getcurrtime() + delay) % inflight.size()].push_back(flight);
+	numInflight++;
+	em->refcount++;
+	emulnet.currbuffsize++;
+
+	ENcount(from.getid(), 1, 0);
+	sent_messages++;
+	sent_bytes += em->size;
+}
+
+/**
+ * FUNCTION NAME: ENarrive
+ *
+ * DESCRIPTION: Moves the copies due at the end of the current time unit into
+ * 				their inboxes
+ */
+void EmulNet::ENarrive() {
+	vector<en_flight> &slot = inflight[par->getcurrtime() % inflight.size()];
+	for ( vector<en_flight>::iterator it = slot.begin(); it != slot.end(); ++it ) {
+		vector<en_msg *> &box = emulnet.inbox[it->to];
+		if( box.empty() ) {
+			delivered.push_back(it->to.getid());
+		}
+		box.push_back(it->em);
+	}
+	numInflight -= slot.size();
+	slot.clear();
+}
+
+/**
+ * FUNCTION NAME: ENnextArrival
+ *
+ * DESCRIPTION: The earliest time unit, from the current one on, at whose end
+ * 				copies in flight arrive. INT_MAX when nothing is in flight
+ */
+int EmulNet::ENnextArrival() {
+	if ( numInflight == 0 ) {
+		return INT_MAX;
+	}
+	int now = par->getcurrtime();
+	for ( int time = now; ; time++ ) {
+		if ( !inflight[time % inflight.size()].empty() ) {
+			return time;
+		}
+	}
+}
 
-	emulnet.buff[emulnet.currbuffsize++] = em;
+/**
+ * FUNCTION NAME: ENsend
+ *
+ * DESCRIPTION: EmulNet send function
+ *
+ * The message is staged with the sender and handed to the network by ENtick,
+ * like every message sent during the tick
+ *
+ * PARAMETERS:
+ *   myaddr: a pointer to the address from which the message was sent
+ *   toaddr: a pointer to the address to which the message is sent
+ *   data: a pointer to the data being sent
+ *   size: the size of the data being sent
+ *
+ * RETURNS:
+ * size
+ */
+int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
+	NodeId toid = toaddr->getNodeId();
+	ENstage(myaddr, &toid, 1, data, size);
+	return size;
+}
 
+/**
+ * FUNCTION NAME: ENmulticast
+ *
+ * DESCRIPTION: EmulNet send function for one message to many nodes
+ *
+ * The message is staged with the sender until ENtick. The data is then copied
+ * once into a frame shared by every destination's inbox, which is returned to
+ * the pool once the last receiver releases it. Each destination gets its own
+ * drop decision and is counted as one message sent, exactly as if ENsend had
+ * been called for each of them in turn
+ *
+ * PARAMETERS:
+ *   myaddr: a pointer to the address from which the message was sent
+ *   toids: the nodes to which the message is sent
+ *   data: a pointer to the data being sent
+ *   size: the size of the data being sent
+ *
+ * RETURNS:
+ * number of destinations the message was staged for
+ */
+int EmulNet::ENmulticast(Address *myaddr, vector<NodeId> &toids, char *data, int size) {
+	return ENstage(myaddr, toids.empty() ? NULL : &toids[0], toids.size(), data, size);
+}
+
+/**
+ * FUNCTION NAME: ENreserve
+ *
+ * DESCRIPTION: Sets aside size bytes at the end of the node's staged data
+ * 				for a message to be built in place. The space stays valid
+ * 				until the node sends anything else, and ENcommit sends the
+ * 				message built in it
+ */
+char *EmulNet::ENreserve(Address *myaddr, int size) {
+	en_stage &nodeStage = stage[*(int *)(myaddr->addr)];
+	nodeStage.reserved = nodeStage.data.size();
+	nodeStage.data.resize(nodeStage.reserved + size);
+	return &nodeStage.data[nodeStage.reserved];
+}
+
+/**
+ * FUNCTION NAME: ENcommit
+ *
+ * DESCRIPTION: Stages the first size bytes of the space from ENreserve as a
+ * 				message to numDests destinations, and gives the rest back
+ */
+int EmulNet::ENcommit(Address *myaddr, NodeId *toids, int numDests, int size) {
 	// myaddr points to the address from which the message originated
 	// so src dereferences this to get the node number that sent the message
-	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
+	en_stage &nodeStage = stage[*(int *)(myaddr->addr)];
+	en_staged send;
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
+	send.from = myaddr->getNodeId();
+	send.offset = nodeStage.reserved;
+	send.size = size;
+	send.firstDest = nodeStage.dests.size();
+	send.numDests = numDests;
 
-  // increment the sent message count for the given node and current time
-	sent_msgs[src][time]++;
+	nodeStage.data.resize(nodeStage.reserved + size);
+	nodeStage.dests.insert(nodeStage.dests.end(), toids, toids + numDests);
+	nodeStage.sends.push_back(send);
 
-	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
-	#endif
+	return send.numDests;
+}
 
-	return size;
+int EmulNet::ENcommit(Address *myaddr, vector<NodeId> &toids, int size) {
+	return ENcommit(myaddr, toids.empty() ? NULL : &toids[0], toids.size(), size);
+}
+
+/**
+ * FUNCTION NAME: ENstage
+ *
+ * DESCRIPTION: Keeps a message to numDests nodes with its sender until ENtick
+ */
+int EmulNet::ENstage(Address *myaddr, NodeId *toids, int numDests, char *data, int size) {
+	memcpy(ENreserve(myaddr, size), data, size);
+	return ENcommit(myaddr, toids, numDests, size);
+}
+
+/**
+ * FUNCTION NAME: ENdeliver
+ *
+ * DESCRIPTION: Hands one staged send to the network
+ */
+void EmulNet::ENdeliver(en_stage &nodeStage, en_staged &send) {
+	en_msg *em = NULL;
+	char *data = &nodeStage.data[0] + send.offset;
+
+	for ( int i = send.firstDest; i < send.firstDest + send.numDests; i++ ) {
+		if( !cuts.empty() && ENisCut(send.from, nodeStage.dests[i]) ) {
+			cut_drops++;
+			continue;
+		}
+		vector<en_msg *> &box = emulnet.inbox[nodeStage.dests[i]];
+		if( !ENaccept(send.size, box) ) {
+			continue;
+		}
+		// the payload is only copied once some destination takes it
+		if( em == NULL ) {
+			em = ENframe(send.from, data, send.size);
+		}
+		// the drop decision and the limits apply when the copy is sent
+		if( !inflight.empty() ) {
+			int delay = ENdelay(send.from, nodeStage.dests[i]);
+			if( delay > 0 ) {
+				ENlaunch(em, send.from, nodeStage.dests[i], delay);
+				continue;
+			}
+		}
+		if( box.empty() ) {
+			delivered.push_back(nodeStage.dests[i].getid());
+		}
+		ENqueue(em, send.from, box);
+	}
 }
 
 /**
@@ -150,71 +411,294 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	// convert data to a c style string
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	// call the overloaded operator with the c style string and the size
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	// the overloaded operator copies the bytes into its own frame, so the
+	// string's buffer can be passed as is
+	return this->ENsend(myaddr, toaddr, (char *)data.data(), (data.length() * sizeof(char)));
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
  * DESCRIPTION: EmulNet receive function
+ * 				The data handed to enq stays in its pooled frame and belongs
+ * 				to the receiver until it passes it to ENrelease
  *
  * RETURN:
  * 0
  */
 int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
 	en_msg *emsg;
 
-  // loop through the messages in the buffer
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		// emsg points to the en_msg struct in buff at position i
-		emsg = emulnet.buff[i];
-
-    // if the two addresses are equal
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			// sz is the size of the message
-			sz = emsg->size;
-			// allocate a c style string large enough to hold message
-			tmp = (char *) malloc(sz * sizeof(char));
-			// copy message into tmp
-			// recall that when messages are placed in the buffer the en_msg is
-			// placed followed by the data so emsg+1 refers to the data
-			memcpy(tmp, (char *)(emsg+1), sz);
-
-      // reduce the buffer size as the message has been dealt with
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
-
-			(*enq)(queue, (char *)tmp, sz);
-
-			free(emsg);
-
-      // myaddr is a pointer to the Address of the destination node
-			// so dst dereferences this pointer to get the node number
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
-
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
-
-      // increments the received message count for the destination node at the
-			// current time
-			recv_msgs[dst][time]++;
-		}
+	// only this node's inbox needs to be looked at
+	unordered_map<NodeId, vector<en_msg *>>::iterator box = emulnet.inbox.find(myaddr->getNodeId());
+	if ( box == emulnet.inbox.end() || box->second.empty() ) {
+		return 0;
+	}
+
+	// myaddr is a pointer to the Address of the destination node
+	// so dst dereferences this pointer to get the node number
+	int dst = *(int *)(myaddr->addr);
+
+	// drain the inbox in the order the messages were sent
+	for ( vector<en_msg *>::iterator it = box->second.begin(); it != box->second.end(); ++it ) {
+		emsg = *it;
+		// recall that when messages are placed in the buffer the en_msg is
+		// placed followed by the data so emsg+1 refers to the data, which is
+		// queued without copying
+		(*enq)(queue, (char *)(emsg+1), emsg->size);
 	}
 
+	// increments the received message count for the destination node at the
+	// current time
+	ENcount(dst, 0, box->second.size());
+
+	// the buffer size is reduced by ENtick, as the messages have been dealt with
+	stage[dst].drained += box->second.size();
+	box->second.clear();
+
 	return 0;
 }
 
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: Drops the receiver's reference to a message obtained from
+ * 				ENrecv. Frames can be shared between receivers, so the
+ * 				reference is only dropped by ENtick
+ */
+void EmulNet::ENrelease(Address *myaddr, char *buff) {
+	stage[*(int *)(myaddr->addr)].released.push_back((en_msg *)buff - 1);
+}
+
+/**
+ * FUNCTION NAME: ENunref
+ *
+ * DESCRIPTION: Drops one reference to a frame. The frame goes back to the
+ * 				pool with the last reference
+ */
+void EmulNet::ENunref(en_msg *em) {
+	if ( --em->refcount == 0 ) {
+		pool.release(em);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Applies what the nodes staged during the tick, node after node
+ * 				from the highest id down, which is the order Application steps
+ * 				them in. The outcome does not depend on how many threads
+ * 				stepped the nodes. Called once at the end of every tick, or
+ * 				at least of every tick in which nodes sent something or copies
+ * 				in flight arrive
+ */
+void EmulNet::ENtick() {
+	delivered.clear();
+	// every node emptied its inbox before any node sent anything
+	for ( int id = (int)stage.size() - 1; id >= 0; id-- ) {
+		en_stage &nodeStage = stage[id];
+		emulnet.currbuffsize -= nodeStage.drained;
+		nodeStage.drained = 0;
+		for ( vector<en_msg *>::iterator it = nodeStage.released.begin(); it != nodeStage.released.end(); ++it ) {
+			ENunref(*it);
+		}
+		nodeStage.released.clear();
+	}
+
+	// copies sent in earlier ticks go ahead of the ones sent in this one
+	if( numInflight > 0 ) {
+		ENarrive();
+	}
+
+	for ( int id = (int)stage.size() - 1; id >= 0; id-- ) {
+		en_stage &nodeStage = stage[id];
+		for ( vector<en_staged>::iterator send = nodeStage.sends.begin(); send != nodeStage.sends.end(); ++send ) {
+			ENdeliver(nodeStage, *send);
+		}
+		nodeStage.data.clear();
+		nodeStage.sends.clear();
+		nodeStage.dests.clear();
+	}
+
+	ENflushCounts();
+}
+
+/**
+ * FUNCTION NAME: ENdelivered
+ *
+ * DESCRIPTION: Ids of the nodes that have messages waiting since the last
+ * 				ENtick and had none before it, each once. A node that drains
+ * 				its inbox every time unit it has messages appears whenever
+ * 				new ones arrive
+ */
+vector<int> &EmulNet::ENdelivered() {
+	return delivered;
+}
+
+/**
+ * FUNCTION NAME: ENmakeCut
+ *
+ * DESCRIPTION: A cut between the nodes with the ids in a and those in b
+ */
+en_cut EmulNet::ENmakeCut(const vector<int> &a, const vector<int> &b) {
+	en_cut cut;
+	cut.a.resize(emulnet.nextid, 0);
+	cut.b.resize(emulnet.nextid, 0);
+	for ( vector<int>::const_iterator id = a.begin(); id != a.end(); ++id ) {
+		if ( *id > 0 && *id < emulnet.nextid ) {
+			cut.a[*id] = 1;
+		}
+	}
+	for ( vector<int>::const_iterator id = b.begin(); id != b.end(); ++id ) {
+		if ( *id > 0 && *id < emulnet.nextid ) {
+			cut.b[*id] = 1;
+		}
+	}
+	return cut;
+}
+
+/**
+ * FUNCTION NAME: ENisCut
+ *
+ * DESCRIPTION: Whether a cut lies between two nodes. Costs two lookups per
+ * 				cut in place
+ */
+bool EmulNet::ENisCut(NodeId from, NodeId to) {
+	size_t src = from.getid();
+	size_t dst = to.getid();
+	for ( vector<en_cut>::iterator cut = cuts.begin(); cut != cuts.end(); ++cut ) {
+		if ( src < cut->a.size() && dst < cut->a.size() && ((cut->a[src] && cut->b[dst]) || (cut->b[src] && cut->a[dst])) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * FUNCTION NAME: ENcut
+ *
+ * DESCRIPTION: Cuts every link between the nodes with the ids in a and those
+ * 				in b, in both directions, until ENheal is called with the
+ * 				same sets. Messages are lost when they are handed to the
+ * 				network, before the drop decision
+ */
+void EmulNet::ENcut(const vector<int> &a, const vector<int> &b) {
+	cuts.push_back(ENmakeCut(a, b));
+}
+
+/**
+ * FUNCTION NAME: ENheal
+ *
+ * DESCRIPTION: Undoes the cuts made between the same two sets, given in
+ * 				either order
+ */
+void EmulNet::ENheal(const vector<int> &a, const vector<int> &b) {
+	en_cut healed = ENmakeCut(a, b);
+	for ( size_t i = 0; i < cuts.size(); ) {
+		if ( (cuts[i].a == healed.a && cuts[i].b == healed.b) || (cuts[i].a == healed.b && cuts[i].b == healed.a) ) {
+			cuts.erase(cuts.begin() + i);
+		} else {
+			i++;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: ENhealAll
+ *
+ * DESCRIPTION: Undoes every cut
+ */
+void EmulNet::ENhealAll() {
+	cuts.clear();
+}
+
+/**
+ * FUNCTION NAME: ENdiscard
+ *
+ * DESCRIPTION: Throws away what waits in a node's inbox, as a restarted
+ * 				process starts with nothing queued. Not to be called while
+ * 				nodes are being stepped
+ */
+void EmulNet::ENdiscard(Address *myaddr) {
+	unordered_map<NodeId, vector<en_msg *>>::iterator box = emulnet.inbox.find(myaddr->getNodeId());
+	if ( box == emulnet.inbox.end() ) {
+		return;
+	}
+	for ( vector<en_msg *>::iterator it = box->second.begin(); it != box->second.end(); ++it ) {
+		ENunref(*it);
+	}
+	emulnet.currbuffsize -= box->second.size();
+	box->second.clear();
+}
+
+/**
+ * FUNCTION NAME: ENsentMessages
+ *
+ * DESCRIPTION: Messages sent by the whole group so far, one per destination
+ */
+long EmulNet::ENsentMessages() {
+	return sent_messages;
+}
+
+/**
+ * FUNCTION NAME: ENsentBytes
+ *
+ * DESCRIPTION: Payload bytes sent by the whole group so far
+ */
+long EmulNet::ENsentBytes() {
+	return sent_bytes;
+}
+
+/**
+ * FUNCTION NAME: ENcutDrops
+ *
+ * DESCRIPTION: Messages lost to cut links so far
+ */
+long EmulNet::ENcutDrops() {
+	return cut_drops;
+}
+
+/**
+ * FUNCTION NAME: ENcount
+ *
+ * DESCRIPTION: Adds to the messages sent and received by a node at the current
+ * 				time
+ */
+void EmulNet::ENcount(int node, int sent, int recv) {
+	if ( node >= (int)sent_msgs.size() ) {
+		sent_msgs.resize(node + 1, 0);
+		recv_msgs.resize(node + 1, 0);
+		sent_totals.resize(node + 1, 0);
+		recv_totals.resize(node + 1, 0);
+	}
+	sent_msgs[node] += sent;
+	recv_msgs[node] += recv;
+}
+
+/**
+ * FUNCTION NAME: ENflushCounts
+ *
+ * DESCRIPTION: Writes one line per node that sent or received anything during
+ * 				the current time to msgcount.log, adds the counts to the
+ * 				totals and starts the counters over
+ */
+void EmulNet::ENflushCounts() {
+	if ( countFile == NULL ) {
+		countFile = fopen("msgcount.log", "w+");
+	}
+	for ( size_t i = 0; i < sent_msgs.size(); i++ ) {
+		if ( sent_msgs[i] == 0 && recv_msgs[i] == 0 ) {
+			continue;
+		}
+		fprintf(countFile, "time %5d node %3d sent %5d recv %5d\n", par->getcurrtime(), (int)i, sent_msgs[i], recv_msgs[i]);
+		sent_totals[i] += sent_msgs[i];
+		recv_totals[i] += recv_msgs[i];
+		sent_msgs[i] = 0;
+		recv_msgs[i] = 0;
+	}
+}
+
 /**
  * FUNCTION NAME: ENcleanup
  *
@@ -222,41 +706,47 @@ int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct ti
  */
 int EmulNet::ENcleanup() {
 	emulnet.nextid=0;
-	int i, j;
-	int sent_total, recv_total;
-
-	FILE* file = fopen("msgcount.log", "w+");
+	int i;
+	long sent_total, recv_total;
+	long group_sent_total = 0, group_recv_total = 0;
 
-	// free everything in the buffer
-	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+	// free everything left in the inboxes
+	for ( unordered_map<NodeId, vector<en_msg *>>::iterator box = emulnet.inbox.begin(); box != emulnet.inbox.end(); ++box ) {
+		for ( vector<en_msg *>::iterator it = box->second.begin(); it != box->second.end(); ++it ) {
+			ENunref(*it);
+		}
 	}
+	emulnet.inbox.clear();
+	for ( vector<vector<en_flight>>::iterator slot = inflight.begin(); slot != inflight.end(); ++slot ) {
+		for ( vector<en_flight>::iterator it = slot->begin(); it != slot->end(); ++it ) {
+			ENunref(it->em);
+		}
+		slot->clear();
+	}
+	numInflight = 0;
+	emulnet.currbuffsize = 0;
+
+	// ENtick flushed every tick already, this only opens the file if no tick
+	// ever ran
+	ENflushCounts();
+	fprintf(countFile, "\n");
 
   // loop through peers
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
-		fprintf(file, "node %3d ", i);
-		sent_total = 0;
-		recv_total = 0;
-
-    // count number of messages sent and received by that peer across time
-		for (j = 0; j < par->getcurrtime(); j++) {
-
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
-			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
-				if (j % 10 == 9) {
-					fprintf(file, "\n         ");
-				}
-			}
-			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
-			}
-		}
-		fprintf(file, "\n");
-		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
+		sent_total = i < (int)sent_totals.size() ? sent_totals[i] : 0;
+		recv_total = i < (int)recv_totals.size() ? recv_totals[i] : 0;
+		fprintf(countFile, "node %3d sent_total %6ld  recv_total %6ld\n", i, sent_total, recv_total);
+		group_sent_total += sent_total;
+		group_recv_total += recv_total;
 	}
 
-	fclose(file);
+	// totals across the whole group, used to compare dissemination modes
+	fprintf(countFile, "group sent_total %ld  recv_total %ld\n", group_sent_total, group_recv_total);
+	fprintf(countFile, "group sent_bytes %ld\n", sent_bytes);
+	// messages lost to EN_BUFFSIZE or EN_INBOXSIZE rather than to MSG_DROP_PROB
+	fprintf(countFile, "group dropped_full %ld\n", full_drops);
+
+	fclose(countFile);
+	countFile = NULL;
 	return 0;
 }
@@ -7,13 +7,10 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
-#define ENBUFFSIZE 30000
-
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "MsgPool.h"
 
 using namespace std;
 
@@ -23,21 +20,81 @@ using namespace std;
 typedef struct en_msg {
 	// Number of bytes after the class
 	int size;
+	// Number of inboxes still holding this frame, a multicast frame is
+	// shared by all its destinations
+	int refcount;
 	// Source node
-	Address from;
-	// Destination node
-	Address to;
+	NodeId from;
 }en_msg;
 
+/**
+ * Struct Name: en_staged
+ *
+ * DESCRIPTION: A send waiting for the end of the tick. Its data and its
+ * 				destinations are ranges in the sender's en_stage
+ */
+typedef struct en_staged {
+	NodeId from;
+	int offset;
+	int size;
+	int firstDest;
+	int numDests;
+}en_staged;
+
+/**
+ * Struct Name: en_stage
+ *
+ * DESCRIPTION: What one node did to the network during the current tick.
+ * 				Nodes may be stepped on several threads at once, so nothing
+ * 				shared is touched until ENtick applies every node's stage in
+ * 				node order
+ */
+typedef struct en_stage {
+	// payload bytes of the staged sends, back to back
+	vector<char> data;
+	vector<en_staged> sends;
+	vector<NodeId> dests;
+	// frames the node is done with
+	vector<en_msg *> released;
+	// messages taken out of the node's inbox
+	int drained;
+	// offset in data of the space handed out by ENreserve
+	int reserved;
+}en_stage;
+
+/**
+ * Struct Name: en_flight
+ *
+ * DESCRIPTION: One copy of a message on its way to a destination that is
+ * 				more than a tick away
+ */
+typedef struct en_flight {
+	en_msg *em;
+	NodeId to;
+}en_flight;
+
+/**
+ * Struct Name: en_cut
+ *
+ * DESCRIPTION: A cut between two sets of nodes, one flag per node id in
+ * 				each. No message crosses it in either direction
+ */
+typedef struct en_cut {
+	vector<char> a;
+	vector<char> b;
+}en_cut;
+
 /**
  * Class Name: EM
  */
 class EM {
 public:
 	int nextid;
+	// total number of messages buffered across all inboxes
 	int currbuffsize;
 	int firsteltindex;
-	en_msg* buff[ENBUFFSIZE];
+	// one inbox per destination node
+	unordered_map<NodeId, vector<en_msg *>> inbox;
 
 	EM() {}
 
@@ -46,11 +103,7 @@ public:
 		this->nextid = anotherEM.getNextId();
 		this->currbuffsize = anotherEM.getCurrBuffSize();
 		this->firsteltindex = anotherEM.getFirstEltIndex();
-		int i = this->currbuffsize;
-		while (i > 0) {
-			this->buff[i] = anotherEM.buff[i];
-			i--;
-		}
+		this->inbox = anotherEM.inbox;
 		return *this;
 	}
 
@@ -88,24 +141,81 @@ public:
  */
 class EmulNet
 {
-private:
+protected:
 	Params* par;
-	// keeps track of messages sent and received from each node
-	// at each unit of time
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	// messages sent and received by each node during the current tick,
+	// indexed by node id and written to msgcount.log by ENtick
+	vector<int> sent_msgs;
+	vector<int> recv_msgs;
+	// per node totals over all flushed ticks
+	vector<long> sent_totals;
+	vector<long> recv_totals;
+	FILE *countFile;
+	// messages turned away because the network or an inbox was full
+	long full_drops;
+	// payload bytes of all the messages sent, one count per destination
+	long sent_bytes;
+	// messages sent by the whole group so far
+	long sent_messages;
+	// links that are cut, and the messages lost to them
+	vector<en_cut> cuts;
+	long cut_drops;
 	int enInited;
 	EM emulnet;
+	// frames live here from ENsend until the receiver hands them to ENrelease
+	MsgPool pool;
+	// one stage per node id
+	vector<en_stage> stage;
+	// ids of the nodes whose inbox the last ENtick filled from empty
+	vector<int> delivered;
+	// copies in flight, one slot per time unit up to the longest delay, each
+	// holding the copies that arrive at the end of time units equal to its
+	// index modulo the number of slots, in the order they were sent. Empty
+	// when no link has a delay
+	vector<vector<en_flight>> inflight;
+	long numInflight;
+	// the delay draws have their own generator, so the drop decisions come
+	// out the same whatever the delays
+	unsigned int delaySeed;
+	int ENdelay(NodeId from, NodeId to);
+	void ENlaunch(en_msg *em, NodeId from, NodeId to, int delay);
+	void ENarrive();
+	en_cut ENmakeCut(const vector<int> &a, const vector<int> &b);
+	bool ENisCut(NodeId from, NodeId to);
+	bool ENdrop(int size);
+	bool ENaccept(int size, vector<en_msg *> &box);
+	en_msg *ENframe(NodeId from, char *data, int size);
+	void ENqueue(en_msg *em, NodeId from, vector<en_msg *> &box);
+	void ENcount(int node, int sent, int recv);
+	void ENflushCounts();
+	int ENstage(Address *myaddr, NodeId *toids, int numDests, char *data, int size);
+	void ENdeliver(en_stage &nodeStage, en_staged &send);
+	void ENunref(en_msg *em);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
  	EmulNet& operator = (EmulNet &anotherEmulNet);
  	virtual ~EmulNet();
-	void *ENinit(Address *myaddr, short port);
+	virtual void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
-	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
-	int ENcleanup();
+	int ENmulticast(Address *myaddr, vector<NodeId> &toids, char *data, int size);
+	char *ENreserve(Address *myaddr, int size);
+	int ENcommit(Address *myaddr, NodeId *toids, int numDests, int size);
+	int ENcommit(Address *myaddr, vector<NodeId> &toids, int size);
+	virtual int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	virtual void ENrelease(Address *myaddr, char *buff);
+	virtual void ENtick();
+	vector<int> &ENdelivered();
+	int ENnextArrival();
+	void ENcut(const vector<int> &a, const vector<int> &b);
+	void ENheal(const vector<int> &a, const vector<int> &b);
+	void ENhealAll();
+	void ENdiscard(Address *myaddr);
+	long ENsentMessages();
+	long ENsentBytes();
+	long ENcutDrops();
+	virtual int ENcleanup();
 };
 
 #endif /* _EMULNET_H_ */
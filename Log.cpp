@@ -12,6 +12,14 @@
 Log::Log(Params *p) {
 	par = p;
 	firstTime = false;
+	addressed = false;
+	staging = false;
+	numwrites = 0;
+	dbgFile = NULL;
+	statsFile = NULL;
+	dbgWriter = NULL;
+	statsWriter = NULL;
+	ownsWriters = true;
 }
 
 /**
@@ -20,6 +28,17 @@ Log::Log(Params *p) {
 Log::Log(const Log &anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->addressed = anotherLog.addressed;
+	this->staging = anotherLog.staging;
+	this->numwrites = anotherLog.numwrites;
+	this->dbgFile = anotherLog.dbgFile;
+	this->statsFile = anotherLog.statsFile;
+	this->dbgWriter = anotherLog.dbgWriter;
+	this->statsWriter = anotherLog.statsWriter;
+	this->ownsWriters = false;
+	this->stagedDbg = anotherLog.stagedDbg;
+	this->stagedStats = anotherLog.stagedStats;
+	this->removeHook = anotherLog.removeHook;
 }
 
 /**
@@ -28,84 +47,229 @@ Log::Log(const Log &anotherLog) {
 Log& Log::operator = (const Log& anotherLog) {
 	this->par = anotherLog.par;
 	this->firstTime = anotherLog.firstTime;
+	this->addressed = anotherLog.addressed;
+	this->staging = anotherLog.staging;
+	this->numwrites = anotherLog.numwrites;
+	this->dbgFile = anotherLog.dbgFile;
+	this->statsFile = anotherLog.statsFile;
+	this->dbgWriter = anotherLog.dbgWriter;
+	this->statsWriter = anotherLog.statsWriter;
+	this->ownsWriters = false;
+	this->stagedDbg = anotherLog.stagedDbg;
+	this->stagedStats = anotherLog.stagedStats;
+	this->removeHook = anotherLog.removeHook;
 	return *this;
 }
 
 /**
  * Destructor
  */
-Log::~Log() {}
+Log::~Log() {
+	// waits for everything logged to be written
+	if (ownsWriters) {
+		delete dbgWriter;
+		delete statsWriter;
+	}
+}
 
 /**
- * FUNCTION NAME: LOG
+ * FUNCTION NAME: formatNode
  *
- * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * DESCRIPTION: Writes a node as the four bytes of its id, each as a signed
+ * 				char, and its port, which is how the logs have always shown a
+ * 				node's Address
  */
-void Log::LOG(Address *addr, const char * str, ...) {
+static int formatNode(char *buffer, NodeId nodeId) {
+	int id = nodeId.getid();
+	return sprintf(buffer, "%d.%d.%d.%d:%d", (char)id, (char)(id >> 8), (char)(id >> 16), (char)(id >> 24), nodeId.getport());
+}
 
-	static FILE *fp;
-	static FILE *fp2;
+/**
+ * FUNCTION NAME: LOG
+ *
+ * DESCRIPTION: Print out to file dbg.log, along with the address of node.
+ * 				While staging, the line is kept with the lines of the node it
+ * 				carries until flushStaged
+ */
+void Log::LOG(NodeId node, const char * str, ...) {
 	va_list vararglist;
-	static char buffer[30000];
-	static int numwrites;
-	static char stdstring[30];
-	static char stdstring2[40];
-	static char stdstring3[40]; 
-	static int dbg_opened=0;
-
-	if(dbg_opened != 639){
+	char buffer[30000];
+	char stdstring[30];
+	char line[30100];
+
+	// the very first line has always gone out without an address
+	if (!addressed) {
+		stdstring[0] = 0;
+		addressed = true;
+	}
+	else {
+		int size = formatNode(stdstring, node);
+		stdstring[size] = ' ';
+		stdstring[size + 1] = 0;
+	}
+
+	va_start(vararglist, str);
+	vsnprintf(buffer, sizeof(buffer), str, vararglist);
+	va_end(vararglist);
+
+	bool stats = (memcmp(buffer, "#STATSLOG#", 10) == 0);
+	if (par->LOG_FORMAT == BINARY_LOG && !stats) {
+		logEvent(node, TEXT_EVENT, strlen(buffer), buffer);
+		return;
+	}
+	snprintf(line, sizeof(line), "\n %s[%d] %s", stdstring, par->getcurrtime(), buffer);
+
+	if (staging) {
+		(stats ? stagedStats : stagedDbg)[node.getid()] += line;
+	}
+	else {
+		writeLines(stats, line, strlen(line));
+	}
+}
+
+/**
+ * FUNCTION NAME: logEvent
+ *
+ * DESCRIPTION: Record an event in dbg.bin, with the text of a TEXT_EVENT
+ * 				in the records after it. Nothing is formatted, LogTool renders
+ * 				the records as the lines LOG would have written
+ */
+void Log::logEvent(NodeId observer, EventTypes type, int subject, const char *text) {
+	LogEvent event;
+	LogEvent *records = &event;
+	int numRecords = 1;
+
+	event.tick = par->getcurrtime();
+	event.observer = observer.getid();
+	event.subject = subject;
+	event.type = type;
+	if (type == TEXT_EVENT) {
+		numRecords += (subject + sizeof(LogEvent) - 1) / sizeof(LogEvent);
+		records = new LogEvent[numRecords];
+		records[0] = event;
+		if (numRecords > 1) {
+			memset(&records[numRecords - 1], 0, sizeof(LogEvent));
+		}
+		memcpy(&records[1], text, subject);
+	}
+	addressed = true;
+
+	if (staging) {
+		stagedDbg[event.observer].append((char *)records, numRecords * sizeof(LogEvent));
+	}
+	else {
+		writeLines(false, (char *)records, numRecords * sizeof(LogEvent));
+	}
+	if (records != &event) {
+		delete[] records;
+	}
+}
+
+/**
+ * FUNCTION NAME: writeLines
+ *
+ * DESCRIPTION: Append size bytes of text to dbg.log, or to stats.log for
+ * 				stats lines, opening both files on first use. With binary
+ * 				logging the text is event records and goes to dbg.bin
+ */
+void Log::writeLines(bool stats, const char *text, size_t size) {
+	char stdstring2[40];
+	char stdstring3[40];
+	char magicLine[16];
+	int magicSize;
+
+	if (dbgFile == NULL && dbgWriter == NULL) {
 		numwrites=0;
 
 		stdstring2[0]=0;
 
 		strcpy(stdstring3, stdstring2);
 
-		strcat(stdstring2, DBG_LOG);
+		strcat(stdstring2, par->LOG_FORMAT == BINARY_LOG ? DBG_BIN : DBG_LOG);
 		strcat(stdstring3, STATS_LOG);
 
-		fp = fopen(stdstring2, "w");
-		fp2 = fopen(stdstring3, "w");
-
-		dbg_opened=639;
+		if (par->LOG_BUFFSIZE > 0) {
+			dbgWriter = new LogWriter(stdstring2, par->LOG_BUFFSIZE);
+			statsWriter = new LogWriter(stdstring3, par->LOG_BUFFSIZE);
+		}
+		else {
+			dbgFile = fopen(stdstring2, "w");
+			statsFile = fopen(stdstring3, "w");
+		}
 	}
-	else 
-
-	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
-
-	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
-	va_end(vararglist);
 
 	if (!firstTime) {
-		int magicNumber = 0;
-		string magic = MAGIC_NUMBER;
-		int len = magic.length();
-		for ( int i = 0; i < len; i++ ) {
-			magicNumber += (int)magic.at(i);
+		if (par->LOG_FORMAT == BINARY_LOG) {
+			int header[3] = {0, EVENT_VERSION, sizeof(LogEvent)};
+			memcpy(header, EVENT_MAGIC, 4);
+			memcpy(magicLine, header, sizeof(header));
+			magicSize = sizeof(header);
+		}
+		else {
+			int magicNumber = 0;
+			string magic = MAGIC_NUMBER;
+			int len = magic.length();
+			for ( int i = 0; i < len; i++ ) {
+				magicNumber += (int)magic.at(i);
+			}
+			magicSize = sprintf(magicLine, "%x\n", magicNumber);
+		}
+		if (dbgWriter != NULL) {
+			dbgWriter->append(magicLine, magicSize);
+		}
+		else {
+			fwrite(magicLine, 1, magicSize, dbgFile);
 		}
-		fprintf(fp, "%x\n", magicNumber);
 		firstTime = true;
 	}
 
-	if(memcmp(buffer, "#STATSLOG#", 10)==0){
-		fprintf(fp2, "\n %s", stdstring);
-		fprintf(fp2, "[%d] ", par->getcurrtime());
-
-		fprintf(fp2, buffer);
+	// the writer threads take care of batching and flushing
+	if (dbgWriter != NULL) {
+		(stats ? statsWriter : dbgWriter)->append(text, size);
+		return;
 	}
-	else{
-		fprintf(fp, "\n %s", stdstring);
-		fprintf(fp, "[%d] ", par->getcurrtime());
-		fprintf(fp, buffer);
 
-	}
+	fwrite(text, 1, size, stats ? statsFile : dbgFile);
 
 	if(++numwrites >= MAXWRITES){
-		fflush(fp);
-		fflush(fp2);
+		fflush(dbgFile);
+		fflush(statsFile);
 		numwrites=0;
 	}
+}
 
+/**
+ * FUNCTION NAME: setStaging
+ *
+ * DESCRIPTION: While staging is on, nodes may log from several threads at
+ * 				once. Their lines are kept per node until flushStaged
+ */
+void Log::setStaging(bool staging) {
+	if (staging && (int)stagedDbg.size() <= par->EN_GPSZ) {
+		// node ids run from 1 to EN_GPSZ
+		stagedDbg.resize(par->EN_GPSZ + 1);
+		stagedStats.resize(par->EN_GPSZ + 1);
+	}
+	this->staging = staging;
+}
+
+/**
+ * FUNCTION NAME: flushStaged
+ *
+ * DESCRIPTION: Write out the staged lines node by node, from the highest node
+ * 				id down, which is the order Application steps the nodes in
+ */
+void Log::flushStaged() {
+	for ( int id = (int)stagedDbg.size() - 1; id >= 0; id-- ) {
+		if (!stagedDbg[id].empty()) {
+			writeLines(false, stagedDbg[id].data(), stagedDbg[id].size());
+			stagedDbg[id].clear();
+		}
+		if (!stagedStats[id].empty()) {
+			writeLines(true, stagedStats[id].data(), stagedStats[id].size());
+			stagedStats[id].clear();
+		}
+	}
 }
 
 /**
@@ -113,9 +277,15 @@ void Log::LOG(Address *addr, const char * str, ...) {
  *
  * DESCRIPTION: To Log a node add
  */
-void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
+void Log::logNodeAdd(NodeId thisNode, NodeId addedNode) {
+	char stdstring[100];
+	char added[30];
+	if (par->LOG_FORMAT == BINARY_LOG) {
+		logEvent(thisNode, JOIN_EVENT, addedNode.getid(), NULL);
+		return;
+	}
+	formatNode(added, addedNode);
+	sprintf(stdstring, "Node %s joined at time %d", added, par->getcurrtime());
     LOG(thisNode, stdstring);
 }
 
@@ -124,8 +294,27 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  *
  * DESCRIPTION: To log a node remove
  */
-void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
+void Log::logNodeRemove(NodeId thisNode, NodeId removedNode) {
+	char stdstring[100];
+	char removed[30];
+	if (removeHook) {
+		removeHook(thisNode, removedNode);
+	}
+	if (par->LOG_FORMAT == BINARY_LOG) {
+		logEvent(thisNode, REMOVE_EVENT, removedNode.getid(), NULL);
+		return;
+	}
+	formatNode(removed, removedNode);
+	sprintf(stdstring, "Node %s removed at time %d", removed, par->getcurrtime());
     LOG(thisNode, stdstring);
 }
+
+/**
+ * FUNCTION NAME: setRemoveHook
+ *
+ * DESCRIPTION: Has hook called on every node removal that is logged, with
+ * 				the node that removed and the node removed
+ */
+void Log::setRemoveHook(const function<void(NodeId, NodeId)> &hook) {
+	removeHook = hook;
+}
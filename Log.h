@@ -10,6 +10,7 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "LogWriter.h"
 
 /*
  * Macros
@@ -19,6 +20,41 @@
 #define MAGIC_NUMBER "CS425"
 #define DBG_LOG "dbg.log"
 #define STATS_LOG "stats.log"
+#define DBG_BIN "dbg.bin"
+// first bytes of dbg.bin, followed by the version and the record size
+#define EVENT_MAGIC "MP1E"
+#define EVENT_VERSION 1
+// longest text a TEXT_EVENT carries, as LOG truncates it
+#define EVENT_MAX_TEXT 29999
+
+/**
+ * Types of the records in dbg.bin
+ */
+enum EventTypes{
+	// Log::logNodeAdd
+	JOIN_EVENT,
+	// Log::logNodeRemove
+	REMOVE_EVENT,
+	// any other line, whose text fills the records that follow
+	TEXT_EVENT
+};
+
+/**
+ * STRUCT NAME: LogEvent
+ *
+ * DESCRIPTION: One record of dbg.bin, in the byte order of the machine that
+ * 				wrote it. Nodes are stored by id, the emulated network gives
+ * 				every node port 0. A TEXT_EVENT is followed by as many records
+ * 				as its text needs, padded with zeros
+ */
+typedef struct LogEvent {
+	int tick;
+	// node that logged the event
+	int observer;
+	// node the event is about, or the length of the text of a TEXT_EVENT
+	unsigned int subject : 24;
+	unsigned int type : 8;
+}LogEvent;
 
 /**
  * CLASS NAME: Log
@@ -29,14 +65,37 @@ class Log{
 private:
 	Params *par;
 	bool firstTime;
+	// whether a line has been logged yet, the first one carries no address
+	bool addressed;
+	bool staging;
+	int numwrites;
+	FILE *dbgFile;
+	FILE *statsFile;
+	// with LOG_BUFFSIZE set, lines go to the files through these instead.
+	// Only the Log that opened them closes them
+	LogWriter *dbgWriter;
+	LogWriter *statsWriter;
+	bool ownsWriters;
+	// lines logged while staging, indexed by node id
+	vector<string> stagedDbg;
+	vector<string> stagedStats;
+	// called with the observer and the removed node on every removal. Nodes
+	// may be stepped on several threads, so it must only touch state of the
+	// observer
+	function<void(NodeId, NodeId)> removeHook;
+	void writeLines(bool stats, const char *text, size_t size);
+	void logEvent(NodeId observer, EventTypes type, int subject, const char *text);
 public:
 	Log(Params *p);
 	Log(const Log &anotherLog);
 	Log& operator = (const Log &anotherLog);
 	virtual ~Log();
-	void LOG(Address *, const char * str, ...);
-	void logNodeAdd(Address *, Address *);
-	void logNodeRemove(Address *, Address *);
+	void LOG(NodeId, const char * str, ...);
+	void logNodeAdd(NodeId, NodeId);
+	void logNodeRemove(NodeId, NodeId);
+	void setStaging(bool staging);
+	void flushStaged();
+	void setRemoveHook(const function<void(NodeId, NodeId)> &hook);
 };
 
 #endif /* _LOG_H_ */
@@ -0,0 +1,256 @@
+/**********************************
+ * FILE NAME: LogTool.cpp
+ *
+ * DESCRIPTION: Offline reader of the binary event log dbg.bin. Renders it as
+ * 				the dbg.log text the same run would have written, or answers
+ * 				queries on the events without rendering them
+ **********************************/
+
+#include "Log.h"
+
+/**
+ * STRUCT NAME: EventStats
+ *
+ * DESCRIPTION: How often events of one type were logged about one node, and
+ * 				when the first and the last of them were
+ */
+struct EventStats {
+	long count;
+	int first;
+	int last;
+	EventStats(): count(0), first(INT_MAX), last(INT_MIN) {}
+	void add(int tick) {
+		count++;
+		first = min(first, tick);
+		last = max(last, tick);
+	}
+};
+
+/**
+ * CLASS NAME: EventReader
+ *
+ * DESCRIPTION: Reads the records of dbg.bin one event at a time
+ */
+class EventReader {
+private:
+	FILE *fp;
+	vector<char> textBuffer;
+public:
+	EventReader(FILE *fp): fp(fp), textBuffer(EVENT_MAX_TEXT + sizeof(LogEvent) + 1) {}
+
+	/**
+	 * FUNCTION NAME: readHeader
+	 *
+	 * DESCRIPTION: Checks that the file is an event log this build can read
+	 */
+	bool readHeader() {
+		int header[3];
+		if (fread(header, sizeof(header), 1, fp) != 1 || memcmp(header, EVENT_MAGIC, 4) != 0) {
+			fprintf(stderr, "Not an event log.\n");
+			return false;
+		}
+		if (header[1] != EVENT_VERSION || header[2] != (int)sizeof(LogEvent)) {
+			fprintf(stderr, "Event log version %d with %d byte records, expected version %d with %d byte records.\n", header[1], header[2], EVENT_VERSION, (int)sizeof(LogEvent));
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * FUNCTION NAME: next
+	 *
+	 * DESCRIPTION: Reads the next event. The text of a TEXT_EVENT is left in
+	 * 				text, NUL terminated
+	 */
+	bool next(LogEvent &event, const char *&text) {
+		if (fread(&event, sizeof(LogEvent), 1, fp) != 1) {
+			return false;
+		}
+		text = NULL;
+		if (event.type == TEXT_EVENT) {
+			if (event.subject > EVENT_MAX_TEXT) {
+				fprintf(stderr, "Corrupt text event at time %d.\n", event.tick);
+				return false;
+			}
+			size_t numRecords = (event.subject + sizeof(LogEvent) - 1) / sizeof(LogEvent);
+			if (fread(&textBuffer[0], sizeof(LogEvent), numRecords, fp) != numRecords) {
+				fprintf(stderr, "Truncated text event at time %d.\n", event.tick);
+				return false;
+			}
+			textBuffer[event.subject] = 0;
+			text = &textBuffer[0];
+		}
+		return true;
+	}
+};
+
+/**
+ * FUNCTION NAME: formatAddress
+ *
+ * DESCRIPTION: Prints the address of node id the way Log does
+ */
+void formatAddress(char *buffer, int id) {
+	sprintf(buffer, "%d.%d.%d.%d:%d", (char)id, (char)(id >> 8), (char)(id >> 16), (char)(id >> 24), 0);
+}
+
+/**
+ * FUNCTION NAME: render
+ *
+ * DESCRIPTION: Writes the dbg.log text of the events to out
+ */
+int render(EventReader &reader, FILE *out) {
+	LogEvent event;
+	const char *text;
+	char observer[32];
+	char subject[32];
+	bool addressed = false;
+
+	int magicNumber = 0;
+	for ( const char *c = MAGIC_NUMBER; *c; c++ ) {
+		magicNumber += (int)*c;
+	}
+	fprintf(out, "%x\n", magicNumber);
+
+	while (reader.next(event, text)) {
+		// the very first line has always gone out without an address
+		observer[0] = 0;
+		if (addressed) {
+			formatAddress(observer, event.observer);
+			strcat(observer, " ");
+		}
+		addressed = true;
+
+		switch (event.type) {
+			case JOIN_EVENT:
+				formatAddress(subject, event.subject);
+				fprintf(out, "\n %s[%d] Node %s joined at time %d", observer, event.tick, subject, event.tick);
+				break;
+			case REMOVE_EVENT:
+				formatAddress(subject, event.subject);
+				fprintf(out, "\n %s[%d] Node %s removed at time %d", observer, event.tick, subject, event.tick);
+				break;
+			case TEXT_EVENT:
+				fprintf(out, "\n %s[%d] %s", observer, event.tick, text);
+				break;
+			default:
+				fprintf(stderr, "Unknown event type %d at time %d.\n", event.type, event.tick);
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: summarize
+ *
+ * DESCRIPTION: Counts the events of type per node they are about, and prints
+ * 				one line per node. With node set, only that node is counted
+ */
+int summarize(EventReader &reader, EventTypes type, const char *label, int node) {
+	LogEvent event;
+	const char *text;
+	map<int, EventStats> stats;
+
+	while (reader.next(event, text)) {
+		if (event.type == (unsigned int)type && (node == 0 || (int)event.subject == node)) {
+			stats[event.subject].add(event.tick);
+		}
+	}
+
+	for ( map<int, EventStats>::iterator it = stats.begin(); it != stats.end(); ++it ) {
+		printf("node %d %s %ld first %d last %d\n", it->first, label, it->second.count, it->second.first, it->second.last);
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: count
+ *
+ * DESCRIPTION: Prints the number of events of each type and the time span
+ * 				they cover
+ */
+int count(EventReader &reader) {
+	LogEvent event;
+	const char *text;
+	long counts[TEXT_EVENT + 1] = {0};
+	int first = INT_MAX;
+	int last = INT_MIN;
+
+	while (reader.next(event, text)) {
+		if (event.type <= TEXT_EVENT) {
+			counts[event.type]++;
+		}
+		first = min(first, event.tick);
+		last = max(last, event.tick);
+	}
+
+	printf("joins %ld\nremovals %ld\ntext %ld\n", counts[JOIN_EVENT], counts[REMOVE_EVENT], counts[TEXT_EVENT]);
+	if (first <= last) {
+		printf("time %d to %d\n", first, last);
+	}
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: usage
+ *
+ * DESCRIPTION: Prints the commands
+ */
+void usage(const char *prog) {
+	printf("Usage: %s command [-n node] [file]\n", prog);
+	printf("  render    write the dbg.log text of the events to standard output\n");
+	printf("  count     number of events of each type\n");
+	printf("  joins     per node, how often it was logged joining and when\n");
+	printf("  removals  per node, how often it was logged removed and when\n");
+	printf("The file defaults to %s. -n restricts joins and removals to one node id.\n", DBG_BIN);
+}
+
+/**
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function
+ */
+int main(int argc, char *argv[]) {
+	const char *path = DBG_BIN;
+	int node = 0;
+
+	if (argc < 2) {
+		usage(argv[0]);
+		return 1;
+	}
+	string command = argv[1];
+	for ( int i = 2; i < argc; i++ ) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			node = atoi(argv[++i]);
+		} else {
+			path = argv[i];
+		}
+	}
+
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return 1;
+	}
+	EventReader reader(fp);
+	if (!reader.readHeader()) {
+		return 1;
+	}
+
+	int result;
+	if (command == "render") {
+		result = render(reader, stdout);
+	} else if (command == "count") {
+		result = count(reader);
+	} else if (command == "joins") {
+		result = summarize(reader, JOIN_EVENT, "joins", node);
+	} else if (command == "removals") {
+		result = summarize(reader, REMOVE_EVENT, "removals", node);
+	} else {
+		usage(argv[0]);
+		result = 1;
+	}
+
+	fclose(fp);
+	return result;
+}
@@ -0,0 +1,179 @@
+/**********************************
+ * FILE NAME: LogWriter.cpp
+ *
+ * DESCRIPTION: Definition of LogWriter class functions
+ **********************************/
+
+#include "LogWriter.h"
+#include <errno.h>
+
+// every open writer, so exit and the signal handlers can reach them
+static atomic<LogWriter *> writers[LOG_MAX_WRITERS];
+
+/**
+ * Constructor
+ */
+LogWriter::LogWriter(const char *path, size_t ringSize): ringSize(ringSize), head(0), tail(0), stopping(false) {
+	static bool handlersInstalled = false;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror(path);
+		exit(1);
+	}
+	ring = (char *) malloc(ringSize);
+
+	for ( int i = 0; i < LOG_MAX_WRITERS; i++ ) {
+		LogWriter *empty = NULL;
+		if (writers[i].compare_exchange_strong(empty, this)) {
+			break;
+		}
+	}
+
+	if (!handlersInstalled) {
+		int fatal[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGINT, SIGTERM};
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = crashHandler;
+		action.sa_flags = SA_RESETHAND;
+		sigemptyset(&action.sa_mask);
+		for ( unsigned int i = 0; i < sizeof(fatal) / sizeof(fatal[0]); i++ ) {
+			sigaction(fatal[i], &action, NULL);
+		}
+		atexit(flushAll);
+		handlersInstalled = true;
+	}
+
+	writer = thread(&LogWriter::writerLoop, this);
+}
+
+/**
+ * Destructor
+ */
+LogWriter::~LogWriter() {
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	wakeWriter.notify_one();
+	writer.join();
+
+	for ( int i = 0; i < LOG_MAX_WRITERS; i++ ) {
+		LogWriter *self = this;
+		writers[i].compare_exchange_strong(self, NULL);
+	}
+	close(fd);
+	free(ring);
+}
+
+/**
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Copies text into the ring. Only one thread may append. When
+ * 				the ring is full it waits for the writer thread, nothing is
+ * 				ever dropped
+ */
+void LogWriter::append(const char *text, size_t size) {
+	while (size > 0) {
+		size_t end = head.load(memory_order_relaxed);
+		size_t space = ringSize - (end - tail.load(memory_order_acquire));
+		if (space == 0) {
+			unique_lock<mutex> guard(lock);
+			wakeWriter.notify_one();
+			wakeAppender.wait(guard, [&]() { return head.load(memory_order_relaxed) != tail.load(memory_order_acquire) + ringSize; });
+			continue;
+		}
+
+		size_t offset = end % ringSize;
+		size_t chunk = min(min(size, space), ringSize - offset);
+		memcpy(ring + offset, text, chunk);
+		head.store(end + chunk, memory_order_release);
+		text += chunk;
+		size -= chunk;
+
+		// wake the writer only when a batch is complete
+		size_t pending = end + chunk - tail.load(memory_order_acquire);
+		if (pending >= LOG_BATCH && pending - chunk < LOG_BATCH) {
+			unique_lock<mutex> guard(lock);
+			wakeWriter.notify_one();
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: writerLoop
+ *
+ * DESCRIPTION: Body of the writer thread. Writes out whatever is in the ring
+ * 				once a batch has piled up, or every LOG_FLUSH_MS, until the
+ * 				writer is stopped and the ring is empty
+ */
+void LogWriter::writerLoop() {
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		wakeWriter.wait_for(guard, chrono::milliseconds(LOG_FLUSH_MS), [&]() {
+			return stopping || head.load(memory_order_acquire) - tail.load(memory_order_relaxed) >= LOG_BATCH;
+		});
+
+		size_t from = tail.load(memory_order_relaxed);
+		size_t to = head.load(memory_order_acquire);
+		if (from == to) {
+			if (stopping) {
+				break;
+			}
+			continue;
+		}
+
+		guard.unlock();
+		writeOut(from, to);
+		guard.lock();
+		tail.store(to, memory_order_release);
+		wakeAppender.notify_one();
+	}
+}
+
+/**
+ * FUNCTION NAME: writeOut
+ *
+ * DESCRIPTION: Writes the ring bytes between the file offsets from and to.
+ * 				Only uses calls that are safe in a signal handler
+ */
+void LogWriter::writeOut(size_t from, size_t to) {
+	while (from < to) {
+		size_t offset = from % ringSize;
+		size_t chunk = min(to - from, ringSize - offset);
+		ssize_t written = pwrite(fd, ring + offset, chunk, from);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		from += written;
+	}
+}
+
+/**
+ * FUNCTION NAME: flushAll
+ *
+ * DESCRIPTION: Writes out what is left in the ring of every open writer,
+ * 				without waiting for their threads
+ */
+void LogWriter::flushAll() {
+	for ( int i = 0; i < LOG_MAX_WRITERS; i++ ) {
+		LogWriter *logWriter = writers[i].load();
+		if (logWriter != NULL) {
+			logWriter->writeOut(logWriter->tail.load(memory_order_acquire), logWriter->head.load(memory_order_acquire));
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: crashHandler
+ *
+ * DESCRIPTION: Saves the logs on a fatal signal, then lets the signal take
+ * 				its default course
+ */
+void LogWriter::crashHandler(int sig) {
+	flushAll();
+	raise(sig);
+}
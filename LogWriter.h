@@ -0,0 +1,59 @@
+/**********************************
+ * FILE NAME: LogWriter.h
+ *
+ * DESCRIPTION: Header file of LogWriter class
+ **********************************/
+
+#ifndef _LOGWRITER_H_
+#define _LOGWRITER_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// bytes that have to pile up before the writer thread is woken for them
+#define LOG_BATCH (64 * 1024)
+// longest a line waits in the ring before it is written anyway
+#define LOG_FLUSH_MS 100
+// log files that can be open at once
+#define LOG_MAX_WRITERS 8
+
+/**
+ * CLASS NAME: LogWriter
+ *
+ * DESCRIPTION: Appends text to a file through an in-memory ring. The thread
+ * 				that logs only copies into the ring, and a background thread
+ * 				writes it out in large batches. Bytes are written at their
+ * 				offset in the file, so writing the same part twice is harmless:
+ * 				whatever is left in the ring is written out on exit, or from
+ * 				the handler of a fatal signal, even if the writer thread is
+ * 				busy with it too
+ */
+class LogWriter {
+private:
+	int fd;
+	char *ring;
+	size_t ringSize;
+	// bytes appended and bytes written since the file was opened, which
+	// are also their offsets in the file
+	atomic<size_t> head;
+	atomic<size_t> tail;
+	thread writer;
+	mutex lock;
+	condition_variable wakeWriter;
+	condition_variable wakeAppender;
+	bool stopping;
+	void writerLoop();
+	void writeOut(size_t from, size_t to);
+	static void flushAll();
+	static void crashHandler(int sig);
+	LogWriter(const LogWriter &anotherWriter);
+	LogWriter& operator = (const LogWriter &anotherWriter);
+public:
+	LogWriter(const char *path, size_t ringSize);
+	virtual ~LogWriter();
+	void append(const char *text, size_t size);
+};
+
+#endif /* _LOGWRITER_H_ */
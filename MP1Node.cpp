@@ -7,28 +7,6 @@
 
 #include "MP1Node.h"
 
-MessageHandler::MessageHandler() {
-	// message is composed of 4 chunks: MessageHdr, followed by join
-	// address, followed by one byte, followed by a long representing heartbeat
-	msgSize = sizeof(MessageHdr) + (sizeof(char) * 6) + 1 + sizeof(long);
-	// allocate space, msg is a MessageHdr pointer
-	msg = (MessageHdr *) malloc(msgSize * sizeof(char));
-}
-
-MessageHandler::~MessageHandler() {
-	free(msg);
-}
-
-void MessageHandler::setMessage(Address *msgAddr, MsgTypes &&msgType, long msgHeartbeat) {
-	// set the message type in the first chunk of msg
-	msg->msgType = msgType;
-	// set the node's address in the second chunk
-	memcpy((char *)(msg+1), &msgAddr->addr, sizeof(msgAddr->addr));
-	// set the heartbeat value in the last chunk
-	memcpy((char *)(msg+1) + 1 + sizeof(msgAddr->addr), &msgHeartbeat, sizeof(long));
-}
-
-
 /**
  * Overloaded Constructor of the MP1Node class
  */
@@ -41,6 +19,15 @@ MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Addres
 	this->log = log;
 	this->par = params;
 	this->memberNode->addr = *address;
+	this->self = address->getNodeId();
+	this->probeSeq = 0;
+	this->probeStart = 0;
+	this->probeActive = false;
+	this->probeIndirect = false;
+	this->probeAcked = false;
+	// each node draws from its own generator, so nodes stepped on different
+	// threads make the same choices as when stepped one after another
+	this->randSeed = rand();
 }
 
 /**
@@ -90,7 +77,7 @@ void MP1Node::nodeStart(char *servaddrstr, short servport) {
     if( initThisNode(&joinaddr) == -1 ) {
 			// node failed
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "init_thisnode failed. Exit.");
+        log->LOG(self, "init_thisnode failed. Exit.");
 #endif
         exit(1);
     }
@@ -99,7 +86,7 @@ void MP1Node::nodeStart(char *servaddrstr, short servport) {
         finishUpThisNode();
 				// can't introduce self to group
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "Unable to join self to group. Exiting.");
+        log->LOG(self, "Unable to join self to group. Exiting.");
 #endif
         exit(1);
     }
@@ -108,6 +95,32 @@ void MP1Node::nodeStart(char *servaddrstr, short servport) {
     return;
 }
 
+/**
+ * FUNCTION NAME: nodeRestart
+ *
+ * DESCRIPTION: Brings the node up joining the group through joinaddr, a
+ * 				member the application knows to be up, rather than through the
+ * 				introducer, which may be down or be this node. A failed node
+ * 				comes back as a restarted process: its table and protocol state
+ * 				start over, and its heartbeat carries on above the last one it
+ * 				sent, so the members that still hold or remember the old one
+ * 				take the new ones as fresher
+ */
+void MP1Node::nodeRestart(Address *joinaddr) {
+	long heartbeat = memberNode->inited ? memberNode->heartbeat + 1 : 0;
+
+	initThisNode(joinaddr);
+	memberNode->heartbeat = heartbeat;
+	memberNode->memberList.heartbeat(0) = memberNode->heartbeat;
+	if( !introduceSelfToGroup(joinaddr) ) {
+		finishUpThisNode();
+#ifdef DEBUGLOG
+		log->LOG(self, "Unable to join self to group. Exiting.");
+#endif
+		exit(1);
+	}
+}
+
 /**
  * FUNCTION NAME: initThisNode
  *
@@ -116,23 +129,26 @@ void MP1Node::nodeStart(char *servaddrstr, short servport) {
 int MP1Node::initThisNode(Address *joinaddr) {
 	// pull the id and port from the array. The id is the first 4 bytes
 	// and the port is the last 2
-	int id = *(int*)(&memberNode->addr.addr);
-	int port = *(short*)(&memberNode->addr.addr[4]);
-
 	memberNode->bFailed = false;
 	memberNode->inited = true;
 	memberNode->inGroup = false;
     // node is up!
 	memberNode->nnb = 0;
 	memberNode->heartbeat = 0;
-	memberNode->pingCounter = TFAIL;
+	memberNode->pingDeadline = -1;
 	memberNode->timeOutCounter = -1;
   initMemberListTable(memberNode);
+	memberNode->trackArrivals = par->DETECTOR == PHI_DETECTOR;
+	probeActive = false;
+	suspects.clear();
+	deltaPeers.clear();
+	tombstones.clear();
+	swimUpdates.clear();
 
 	// add myself to my memberListTable
-	MemberListEntry me = MemberListEntry(id, port, 0, par->getcurrtime());
-	memberNode->memberList.push_back(me);
-	log->logNodeAdd(&memberNode->addr, &memberNode->addr);
+	MemberListEntry me = MemberListEntry(self.getid(), self.getport(), 0, par->getcurrtime());
+	memberNode->addMember(me);
+	log->logNodeAdd(self, self);
 
   return 0;
 }
@@ -149,27 +165,26 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 
 		// the join address of a group is set to the address of the first
 		// node in the group. So if these are equal you are booting up the group
-    if ( 0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
+    NodeId joinId = joinaddr->getNodeId();
+    if ( self == joinId ) {
         // I am the group booter (first process to join the group). Boot up the group
 #ifdef DEBUGLOG
-        log->LOG(&memberNode->addr, "Starting up group...");
+        log->LOG(self, "Starting up group...");
 #endif
         memberNode->inGroup = true;
     }
     else {
-			  // setup a JOINREQ message using the handler
-				MessageHandler requestHandler;
-				requestHandler.setMessage(&memberNode->addr, JOINREQ, memberNode->heartbeat);
+			  // setup a JOINREQ message using the handler, right in the send buffer
+				MessageHandler requestHandler(emulNet->ENreserve(&memberNode->addr, WIRE_MAX_HEADER), WIRE_MAX_HEADER);
+				requestHandler.setMessage(self, JOINREQ, memberNode->heartbeat);
 
 #ifdef DEBUGLOG
         sprintf(s, "Trying to join...");
-        log->LOG(&memberNode->addr, s);
+        log->LOG(self, s);
 #endif
 
         // send JOINREQ message to introducer member
-        emulNet->ENsend(&memberNode->addr, joinaddr,
-					              (char *)(requestHandler.getMessage()),
-												requestHandler.getMessageSize());
+        emulNet->ENcommit(&memberNode->addr, &joinId, 1, requestHandler.getMessageSize());
     }
 
     return 1;
@@ -185,12 +200,12 @@ int MP1Node::finishUpThisNode(){
 	if (memberNode->inited) {
 		memberNode->inGroup = false;
 		memberNode->bFailed = true;
-		memberNode->memberList.clear();
+		memberNode->clearMembers();
 		memberNode->inited = false;
 		// node is down!
 		memberNode->nnb = 0;
 		memberNode->heartbeat = 0;
-		memberNode->pingCounter = 0;
+		memberNode->pingDeadline = -1;
 		memberNode->timeOutCounter = 0;
 	}
 	return 0;
@@ -237,6 +252,8 @@ void MP1Node::checkMessages() {
     	size = memberNode->mp1q.front().size;
     	memberNode->mp1q.pop();
     	recvCallBack((void *)memberNode, (char *)ptr, size);
+    	// the message is fully handled, give its buffer back to the network
+    	emulNet->ENrelease(&memberNode->addr, (char *)ptr);
     }
     return;
 }
@@ -248,41 +265,95 @@ void MP1Node::checkMessages() {
  */
 bool MP1Node::recvCallBack(void *env, char *data, int size ) {
 	#ifdef DEBUGLOG
-		static char logMsg[1024];
+		char logMsg[1024];
 	#endif
 
-  // parse the message
-	MessageHdr *sourceHdr = (MessageHdr *)(data);
-	Address *sourceAddr = (Address *)(data + sizeof(MessageHdr));
-	long *sourceHeartbeat = (long *)(data + sizeof(MessageHdr) + sizeof(Address) + 1);
+  // read the message where it was received
+	MessageView view(data, size);
+	if (!view.isValid()) {
+		return false;
+	}
+	MsgTypes msgType = view.getType();
+	NodeId sourceId = view.getSender();
 
-	if (sourceHdr->msgType == JOINREQ) {
-		// construct reply message
-		MessageHandler replyHandler;
-		replyHandler.setMessage(&memberNode->addr, JOINREP, memberNode->heartbeat);
+	// SWIM probes carry a sequence number rather than a heartbeat
+	if (msgType == PING || msgType == PINGREQ || msgType == ACK) {
+		recvSwimMessage(view);
+		return true;
+	}
 
-    // send reply message
-		emulNet->ENsend(&memberNode->addr, sourceAddr,
-			              (char *)(replyHandler.getMessage()),
-										replyHandler.getMessageSize());
+	if (msgType == JOINREQ) {
+		sendJoinReply(sourceId);
 
     // take format of log message from Log.cpp
 		#ifdef DEBUGLOG
-			sprintf(logMsg, "Sending reply message for join request to %d.%d.%d.%d:%d", sourceAddr->addr[0], sourceAddr->addr[1], sourceAddr->addr[2], sourceAddr->addr[3], *(short *)&sourceAddr->addr[4]);
-			log->LOG(&memberNode->addr, logMsg);
+			sprintf(logMsg, "Sending reply message for join request to %d.%d.%d.%d:%d", (char)sourceId.getid(), (char)(sourceId.getid() >> 8), (char)(sourceId.getid() >> 16), (char)(sourceId.getid() >> 24), sourceId.getport());
+			log->LOG(self, logMsg);
 		#endif
 
-	} else if (sourceHdr->msgType == JOINREP) {
+	} else if (msgType == JOINREP) {
 		// this peer received a join reply so it is now in the group
 		memberNode->inGroup = true;
 	}
 
 	// update the membership table based on the received heartbeat
-	updateMemberHeartbeat(sourceAddr, *sourceHeartbeat);
+	updateMemberHeartbeat(sourceId, view.getHeartbeat(), view.getTtl(), true);
+
+	// merge any digest piggybacked after the heartbeat in one pass
+	if (msgType == HEARTBEAT || msgType == JOINREP) {
+		mergeDigest(view);
+	} else if (msgType == DELTA) {
+		recvDelta(view);
+	}
+
+	// with SWIM the rest of the group hears of a new member from the introducer.
+	// A restarted member may still be suspected here, and the join request
+	// already brought its new incarnation, which the alive update it answers
+	// the suspicion with would not be newer than
+	if (msgType == JOINREQ && par->DETECTOR == SWIM_DETECTOR) {
+		suspects.erase(sourceId);
+		queueSwimUpdate(sourceId, view.getHeartbeat(), ALIVE);
+	}
 
 	return true;
 }
 
+/**
+ * FUNCTION NAME: sendJoinReply
+ *
+ * DESCRIPTION: Answer a join request. SWIM members only hear about each other
+ * 				through piggybacked updates, so in that mode the reply also hands
+ * 				over the introducer's membership table, split over as many
+ * 				replies as MAX_MSG_SIZE requires
+ */
+void MP1Node::sendJoinReply(NodeId joinId) {
+	int maxSize = par->DETECTOR == SWIM_DETECTOR ? maxMessageSize() : WIRE_MAX_HEADER;
+	size_t pos = 1;
+
+	do {
+		// construct reply message
+		MessageHandler replyHandler(emulNet->ENreserve(&memberNode->addr, maxSize), maxSize);
+		replyHandler.setMessage(self, JOINREP, memberNode->heartbeat);
+		if (par->DETECTOR == SWIM_DETECTOR) {
+			for (; pos < memberNode->memberList.size() && replyHandler.hasRoomFor(WIRE_MAX_DIGEST_ENTRY); pos++) {
+				replyHandler.addDigestEntry(memberNode->memberList.nodeId(pos), memberNode->memberList.heartbeat(pos));
+			}
+		}
+
+		// send reply message
+		emulNet->ENcommit(&memberNode->addr, &joinId, 1, replyHandler.getMessageSize());
+	} while (par->DETECTOR == SWIM_DETECTOR && pos < memberNode->memberList.size());
+}
+
+/**
+ * FUNCTION NAME: maxMessageSize
+ *
+ * DESCRIPTION: Largest message EmulNet accepts next to its own header
+ */
+int MP1Node::maxMessageSize() {
+	return par->MAX_MSG_SIZE - (int)sizeof(en_msg) - 1;
+}
+
 /**
  * FUNCTION NAME: nodeLoopOps
  *
@@ -291,30 +362,142 @@ bool MP1Node::recvCallBack(void *env, char *data, int size ) {
  * 				Propagate your membership list
  */
 void MP1Node::nodeLoopOps() {
-	// if pings have reached 0, send heartbeat and reset ping counter
-	if (memberNode->pingCounter == 0) {
+	int now = par->getcurrtime();
+
+	// the first round in the group starts the schedule of heartbeats or
+	// probes, the first one is due TFAIL time units later
+	if (memberNode->pingDeadline < 0) {
+		memberNode->pingDeadline = now + TFAIL;
+	}
+
+	// SWIM probes members actively instead of waiting for heartbeats
+	if (par->DETECTOR == SWIM_DETECTOR) {
+		swimLoopOps();
+		return;
+	}
+
+	// once the deadline is reached, send a heartbeat and set the next one
+	if (now >= memberNode->pingDeadline) {
 		memberNode->heartbeat++;
 		sendHeartbeatToPeers();
-		memberNode->pingCounter = TFAIL;
-	} else {
-		// otherwise decremenet ping counter
-		memberNode->pingCounter--;
+		memberNode->pingDeadline = now + TFAIL + 1;
+	}
+
+	// remove any node that you have not heard from in over TREMOVE time: its
+	// expiry timer, re-armed on every fresher heartbeat, has fired
+	if (par->DETECTOR == HEARTBEAT_DETECTOR) {
+		expiredKeys.clear();
+		memberNode->expiryWheel.advance(now, expiredKeys);
+		expiredPositions.clear();
+		for (vector<long long>::iterator key = expiredKeys.begin(); key != expiredKeys.end(); ++key) {
+			int pos = memberNode->findMember(NodeId((unsigned long long)*key));
+			if (pos < 0) {
+				continue;
+			}
+			// the timer is already gone
+			memberNode->expiryTimers[pos] = -1;
+			expiredPositions.push_back(pos);
+		}
+		// remove them in the order a scan from the front of the list would,
+		// so the list ends up in the same order: removal moves the last entry
+		// into the freed slot, and when that one expired too it goes next
+		sort(expiredPositions.begin(), expiredPositions.end());
+		size_t first = 0;
+		size_t end = expiredPositions.size();
+		while (first < end) {
+			size_t pos = expiredPositions[first];
+			size_t last = memberNode->memberList.size() - 1;
+			removeExpiredMember(pos);
+			if (pos != last && expiredPositions[end - 1] == last) {
+				end--;
+			} else {
+				first++;
+			}
+		}
+		return;
 	}
 
-	// remove any node that you have not heard from in over TREMOVE time (except youself)
-	for (vector<MemberListEntry>::iterator mle = memberNode->memberList.begin()+1; mle != memberNode->memberList.end(); ++mle) {
-		if (par->getcurrtime() - mle->gettimestamp() > TREMOVE) {
-			Address removeAddr;
-			*(int *)(&(removeAddr.addr)) = mle->id;
-			*(short *)(&(removeAddr.addr[4])) = mle->port;
-			memberNode->memberList.erase(mle);
-			log->logNodeRemove(&memberNode->addr, &removeAddr);
+	// with phi accrual the suspicion level rises continuously, so every member
+	// is looked at (except youself). Removal moves the last entry into the
+	// freed slot, so only advance when the current entry is kept
+	size_t pos = 1;
+	while (pos < memberNode->memberList.size()) {
+		if (hasExpired(pos)) {
+			removeExpiredMember(pos);
+		} else {
+			pos++;
 		}
 	}
 
   return;
 }
 
+/**
+ * FUNCTION NAME: removeExpiredMember
+ *
+ * DESCRIPTION: Removes the member at position pos and logs the removal
+ */
+void MP1Node::removeExpiredMember(size_t pos) {
+	NodeId removeId = memberNode->memberList.nodeId(pos);
+	// logged first, so that a removal hook still finds the entry
+	log->logNodeRemove(self, removeId);
+	deltaPeers.erase(removeId);
+	memberNode->removeMember(pos);
+}
+
+/**
+ * FUNCTION NAME: nextDeadline
+ *
+ * DESCRIPTION: The earliest time at which nodeLoopOps has something to do
+ * 				without new messages coming in: the next heartbeat or probe,
+ * 				an unanswered probe to escalate, or a member or suspect to
+ * 				expire. INT_MAX while the node is outside the group
+ */
+int MP1Node::nextDeadline() {
+	int now = par->getcurrtime();
+	if (memberNode->bFailed || !memberNode->inGroup) {
+		return INT_MAX;
+	}
+	// the first round in the group sets up the schedule
+	if (memberNode->pingDeadline < 0) {
+		return now;
+	}
+	int deadline = memberNode->pingDeadline;
+
+	if (par->DETECTOR == SWIM_DETECTOR) {
+		if (probeActive && !probeAcked && !probeIndirect) {
+			deadline = min(deadline, probeStart + par->SWIM_TIMEOUT);
+		}
+		for (unordered_map<NodeId, int>::iterator it = suspects.begin(); it != suspects.end(); ++it) {
+			deadline = min(deadline, it->second + par->SWIM_SUSPECT + 1);
+		}
+	} else if (memberNode->memberList.size() > 1) {
+		// the suspicion level of phi accrual rises continuously
+		if (par->DETECTOR == PHI_DETECTOR) {
+			return now + 1;
+		}
+		long expiry = memberNode->expiryWheel.nextDeadline();
+		if (expiry < deadline) {
+			deadline = expiry;
+		}
+	}
+	return max(deadline, now);
+}
+
+/**
+ * FUNCTION NAME: hasExpired
+ *
+ * DESCRIPTION: Whether the member at position pos should be removed: after
+ * 				TREMOVE time units without a fresher heartbeat, or with phi
+ * 				accrual once its suspicion level crosses PHI_THRESHOLD
+ */
+bool MP1Node::hasExpired(size_t pos) {
+	if (par->DETECTOR == PHI_DETECTOR) {
+		return memberNode->arrivalHistory[pos].phi(par->getcurrtime(), par->PHI_MIN_STDDEV) > par->PHI_THRESHOLD;
+	}
+	return par->getcurrtime() - memberNode->memberList.timestamp(pos) > TREMOVE;
+}
+
 /**
  * FUNCTION NAME: isNullAddress
  *
@@ -347,7 +530,7 @@ Address MP1Node::getJoinAddress() {
  * DESCRIPTION: Initialize the membership list
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
-	memberNode->memberList.clear();
+	memberNode->clearMembers();
 }
 
 /**
@@ -361,75 +544,636 @@ void MP1Node::printAddress(Address *addr)
                                                        addr->addr[3], *(short*)&addr->addr[4]) ;
 }
 
+/**
+ * FUNCTION NAME: sendHeartbeatToPeers
+ *
+ * DESCRIPTION: Bump your own heartbeat in the table and send it to your peers.
+ * 				In flood mode it goes to every member, in gossip mode to a random
+ * 				fanout of members with a fresh time-to-live
+ */
 void MP1Node::sendHeartbeatToPeers() {
+	// the node's own entry is always first in the table
+	memberNode->memberList.heartbeat(0) = memberNode->heartbeat;
+
+	if (par->HEARTBEAT_DELTA) {
+		sendDeltaToPeers();
+		return;
+	}
+	if (par->HEARTBEAT_DIGEST) {
+		sendDigestToPeers();
+		return;
+	}
+
+	// construct heartbeat message
+	MessageHandler heartbeatHandler(emulNet->ENreserve(&memberNode->addr, WIRE_MAX_HEADER), WIRE_MAX_HEADER);
+	if (par->DISSEMINATION == GOSSIP) {
+		heartbeatHandler.setMessage(self, HEARTBEAT, memberNode->heartbeat, par->GOSSIP_TTL);
+		sendToRandomPeers(heartbeatHandler, par->GOSSIP_FANOUT);
+	} else {
+		heartbeatHandler.setMessage(self, HEARTBEAT, memberNode->heartbeat);
+		sendToAllPeers(heartbeatHandler);
+	}
+}
+
+/**
+ * FUNCTION NAME: sendReceivedHeartbeatToPeers
+ *
+ * DESCRIPTION: Pass on a fresher heartbeat for another member. In flood mode it
+ * 				goes to every member, in gossip mode it is forwarded to a random
+ * 				fanout while its time-to-live lasts. With digests nothing is
+ * 				forwarded, the update rides along with the next digest instead,
+ * 				and SWIM never sends heartbeats at all
+ */
+void MP1Node::sendReceivedHeartbeatToPeers(NodeId receivedId, long receivedHeartbeat, char ttl) {
+	if (par->HEARTBEAT_DIGEST || par->DETECTOR == SWIM_DETECTOR) {
+		return;
+	}
+
+	// the heartbeat has done its rounds
+	if (par->DISSEMINATION == GOSSIP && ttl <= 0) {
+		return;
+	}
+
 	// construct heartbeat message
-	MessageHandler heartbeatHandler;
-	heartbeatHandler.setMessage(&memberNode->addr, HEARTBEAT, memberNode->heartbeat);
-
-	int id = *(int *)(&memberNode->addr.addr);
-	int port = *(short *)(&memberNode->addr.addr[4]);
-
-	// send heartbeat to all of your peers
-	for (vector<MemberListEntry>::iterator mle = memberNode->memberList.begin(); mle != memberNode->memberList.end(); ++mle) {
-    // don't send heartbeat to yourself
-		if ((id != mle->id) || (port != mle->port)) {
-			Address sendAddress;
-			*(int *)(&(sendAddress.addr)) = mle->id;
-			*(short *)(&(sendAddress.addr[4])) = mle->port;
-			emulNet->ENsend(&memberNode->addr, &sendAddress,
-				              (char *)(heartbeatHandler.getMessage()),
-											heartbeatHandler.getMessageSize());
+	MessageHandler heartbeatHandler(emulNet->ENreserve(&memberNode->addr, WIRE_MAX_HEADER), WIRE_MAX_HEADER);
+	if (par->DISSEMINATION == GOSSIP) {
+		heartbeatHandler.setMessage(receivedId, HEARTBEAT, receivedHeartbeat, ttl - 1);
+		sendToRandomPeers(heartbeatHandler, par->GOSSIP_FANOUT);
+	} else {
+		heartbeatHandler.setMessage(receivedId, HEARTBEAT, receivedHeartbeat);
+		sendToAllPeers(heartbeatHandler);
+	}
+}
+
+/**
+ * FUNCTION NAME: sendDigestToPeers
+ *
+ * DESCRIPTION: Send your heartbeat together with the fresh part of your
+ * 				membership table. Entries are packed into as few messages as
+ * 				MAX_MSG_SIZE allows, and each message goes to every member or
+ * 				to a random fanout depending on the dissemination mode
+ */
+void MP1Node::sendDigestToPeers() {
+	// EmulNet refuses messages that do not fit with its own header
+	int maxSize = maxMessageSize();
+	MemberStore &memberList = memberNode->memberList;
+	freshPositions.clear();
+	memberList.selectByAge(1, par->getcurrtime(), -1, TDIGEST, freshPositions);
+	size_t next = 0;
+
+	// the first message always goes out, even without entries, since it
+	// carries this node's own heartbeat
+	do {
+		MessageHandler digestHandler(emulNet->ENreserve(&memberNode->addr, maxSize), maxSize);
+		digestHandler.setMessage(self, HEARTBEAT, memberNode->heartbeat);
+		for (; next < freshPositions.size() && digestHandler.hasRoomFor(WIRE_MAX_DIGEST_ENTRY); next++) {
+			int pos = freshPositions[next];
+			digestHandler.addDigestEntry(memberList.nodeId(pos), memberList.heartbeat(pos));
+		}
+
+		if (par->DISSEMINATION == GOSSIP) {
+			sendToRandomPeers(digestHandler, par->GOSSIP_FANOUT);
 		} else {
-			// otherwise update your own heartbeat in the table
-			mle->heartbeat = memberNode->heartbeat;
+			sendToAllPeers(digestHandler);
+		}
+	} while (next < freshPositions.size());
+}
+
+/**
+ * FUNCTION NAME: sendDeltaToPeers
+ *
+ * DESCRIPTION: Send your heartbeat to every member, or to a random fanout,
+ * 				with only the changes to your membership table that member has
+ * 				not acknowledged yet, and your own acknowledgement of its
+ * 				changes. Every delta carries all changes after the version it
+ * 				starts from, so a lost one is made up for by the next. As with
+ * 				digests, entries not refreshed within TDIGEST are left out.
+ * 				When flooding, the first delta to each member also names the
+ * 				members whose latest heartbeat we missed
+ */
+void MP1Node::sendDeltaToPeers() {
+	int maxSize = maxMessageSize();
+	int now = par->getcurrtime();
+	MemberStore &memberList = memberNode->memberList;
+	vector<pair<long, NodeId> > &changeLog = memberNode->changeLog;
+	// entries that fit in one message however long their encoding
+	size_t perMessage = max(1, (maxSize - WIRE_MAX_HEADER - WIRE_MAX_VERSIONS) / WIRE_MAX_DIGEST_ENTRY);
+
+	deltaRequests.clear();
+	if (par->DISSEMINATION == GOSSIP) {
+		deltaTargets = pickRandomPeers(par->GOSSIP_FANOUT, NodeId());
+	} else {
+		deltaTargets.clear();
+		for (int pos = 1; pos < (int)memberList.size(); pos++) {
+			deltaTargets.push_back(pos);
+		}
+		// direct heartbeats are not passed on, so a member whose last one was
+		// lost is named with the heartbeat we have, and whoever has a fresher
+		// one passes it on again
+		memberList.selectByAge(1, now, TFAIL + 1, TDIGEST, deltaRequests);
+	}
+
+	for (vector<int>::iterator target = deltaTargets.begin(); target != deltaTargets.end(); ++target) {
+		NodeId peerId = memberList.nodeId(*target);
+		DeltaPeer &peer = deltaPeers[peerId];
+
+		// changeLog is in version order, start at the first change the
+		// member has not acknowledged
+		long base = peer.acked;
+		size_t next = upper_bound(changeLog.begin(), changeLog.end(), make_pair(base, NodeId(ULLONG_MAX))) - changeLog.begin();
+		deltaEntries.clear();
+		for (vector<int>::iterator pos = deltaRequests.begin(); pos != deltaRequests.end() && deltaEntries.size() < perMessage; ++pos) {
+			if (*pos != *target) {
+				deltaEntries.push_back(*pos);
+			}
 		}
+		int numRequests = deltaEntries.size();
+		bool followUp = false;
+		do {
+			size_t first = next;
+			for (; next < changeLog.size() && deltaEntries.size() < perMessage; next++) {
+				// skip changes made again since, removed members, the member's
+				// own entry and stale entries
+				int pos = memberNode->findMember(changeLog[next].second);
+				if (pos < 0 || changeLog[next].second == peerId) {
+					continue;
+				}
+				if (memberNode->versions[pos] == changeLog[next].first && now - memberList.timestamp(pos) <= TDIGEST) {
+					deltaEntries.push_back(pos);
+				}
+			}
+			// a full message covers the changes up to the last one looked at,
+			// and none of them when the requests alone filled it
+			long version = next == changeLog.size() ? memberNode->version : next > first ? changeLog[next - 1].first : base;
+			// a follow-up with nothing in it is not sent, the next round
+			// starts from the same base
+			if (followUp && deltaEntries.empty()) {
+				break;
+			}
+
+			MessageHandler deltaHandler(emulNet->ENreserve(&memberNode->addr, maxSize), maxSize);
+			deltaHandler.setMessage(self, DELTA, memberNode->heartbeat);
+			deltaHandler.addVersions(peer.seen, base, version, numRequests);
+			for (vector<int>::iterator pos = deltaEntries.begin(); pos != deltaEntries.end(); ++pos) {
+				deltaHandler.addDigestEntry(memberList.nodeId(*pos), memberList.heartbeat(*pos));
+			}
+			emulNet->ENcommit(&memberNode->addr, &peerId, 1, deltaHandler.getMessageSize());
+			base = version;
+			deltaEntries.clear();
+			numRequests = 0;
+			followUp = true;
+		} while (next < changeLog.size());
 	}
 }
 
-void MP1Node::sendReceivedHeartbeatToPeers(Address *receivedAddr, long receivedHeartbeat) {
-	// construct heartbeat message
-	MessageHandler heartbeatHandler;
-	heartbeatHandler.setMessage(receivedAddr, HEARTBEAT, receivedHeartbeat);
-
-	int id = *(int *)(&memberNode->addr.addr);
-	int port = *(short *)(&memberNode->addr.addr[4]);
-
-	for (vector<MemberListEntry>::iterator mle = memberNode->memberList.begin()+1; mle != memberNode->memberList.end(); ++mle) {
-		if ((id != mle->id) || (port != mle->port)) {
-			Address sendAddress;
-			*(int *)(&(sendAddress.addr)) = mle->id;
-			*(short *)(&(sendAddress.addr[4])) = mle->port;
-			emulNet->ENsend(&memberNode->addr, &sendAddress,
-				              (char *)(heartbeatHandler.getMessage()),
-										  heartbeatHandler.getMessageSize());
-		}
-	}
-}
-
-void MP1Node::updateMemberHeartbeat(Address *fromAddr, long heartbeat) {
-	// loop through member list searching for the member who sent the heartbeat
-	for (vector<MemberListEntry>::iterator mle = memberNode->memberList.begin(); mle != memberNode->memberList.end(); ++mle) {
-		Address memberAddr;
-		*(int *)(&(memberAddr.addr)) = mle->id;
-		*(short *)(&(memberAddr.addr[4])) = mle->port;
-
-		// check if it is the member who sent the heartbeat
-		if (memberAddr == *fromAddr) {
-			// update if the received heartbeat is later than the current heartbeat in the MemberListEntry mle
-			if (heartbeat > mle->getheartbeat()) {
-				mle->setheartbeat(heartbeat);
-				mle->settimestamp(par->getcurrtime());
-				sendReceivedHeartbeatToPeers(fromAddr, heartbeat);
+/**
+ * FUNCTION NAME: recvDelta
+ *
+ * DESCRIPTION: Take note of the sender's acknowledgement and merge its
+ * 				changes. We have all of its changes up to the delta's version
+ * 				only if we had them up to the version the delta starts from.
+ * 				Requests older than ours are answered with our heartbeat
+ */
+void MP1Node::recvDelta(MessageView &view) {
+	long ack, base, version;
+	int numRequests;
+	if (!view.readVersions(ack, base, version, numRequests)) {
+		return;
+	}
+	DeltaPeer &peer = deltaPeers[view.getSender()];
+	peer.acked = ack;
+	if (base <= peer.seen && version > peer.seen) {
+		peer.seen = version;
+	}
+
+	NodeId entryId;
+	long heartbeat;
+	for (int i = 0; view.nextDigestEntry(entryId, heartbeat); i++) {
+		int pos = memberNode->findMember(entryId);
+		if (i >= numRequests || pos < 0 || heartbeat >= memberNode->memberList.heartbeat(pos)) {
+			updateMemberHeartbeat(entryId, heartbeat, 0);
+			continue;
+		}
+		// the sender missed a heartbeat we have, and has all our changes, so
+		// that heartbeat is passed on again unless it is stale by now
+		if (pos > 0 && memberNode->versions[pos] <= peer.acked && par->getcurrtime() - memberNode->memberList.timestamp(pos) <= TDIGEST) {
+			memberNode->touchMember(pos);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: mergeDigest
+ *
+ * DESCRIPTION: Fold a received digest into the membership table
+ */
+void MP1Node::mergeDigest(MessageView &view) {
+	NodeId entryId;
+	long heartbeat;
+	while (view.nextDigestEntry(entryId, heartbeat)) {
+		updateMemberHeartbeat(entryId, heartbeat, 0);
+	}
+}
+
+/**
+ * FUNCTION NAME: sendToAllPeers
+ *
+ * DESCRIPTION: Send the message to every member except yourself
+ */
+void MP1Node::sendToAllPeers(MessageHandler &handler) {
+	peerIds.clear();
+	for (size_t pos = 1; pos < memberNode->memberList.size(); pos++) {
+		peerIds.push_back(memberNode->memberList.nodeId(pos));
+	}
+	emulNet->ENcommit(&memberNode->addr, peerIds, handler.getMessageSize());
+}
+
+/**
+ * FUNCTION NAME: sendToRandomPeers
+ *
+ * DESCRIPTION: Send the message to fanout distinct members chosen uniformly at
+ * 				random, never to yourself. If the group is no larger than the
+ * 				fanout every member gets it
+ */
+void MP1Node::sendToRandomPeers(MessageHandler &handler, int fanout) {
+	vector<int> chosen = pickRandomPeers(fanout, NodeId());
+
+	peerIds.clear();
+	for (vector<int>::iterator pos = chosen.begin(); pos != chosen.end(); ++pos) {
+		peerIds.push_back(memberNode->memberList.nodeId(*pos));
+	}
+	emulNet->ENcommit(&memberNode->addr, peerIds, handler.getMessageSize());
+}
+
+/**
+ * FUNCTION NAME: pickRandomPeers
+ *
+ * DESCRIPTION: Returns the table positions of count distinct members chosen
+ * 				uniformly at random, never yourself nor the member excludeId,
+ * 				which the null NodeId leaves unset. If there are no more than
+ * 				count candidates they are all returned
+ */
+vector<int> MP1Node::pickRandomPeers(int count, NodeId excludeId) {
+	// position 0 is this node, so peers live in positions 1..numPeers
+	int numPeers = memberNode->memberList.size() - 1;
+	int numCandidates = numPeers - (memberNode->findMember(excludeId) >= 0 ? 1 : 0);
+	vector<int> chosen;
+
+	if (numCandidates <= count) {
+		for (int pos = 1; pos <= numPeers; pos++) {
+			if (memberNode->memberList.nodeId(pos) != excludeId) {
+				chosen.push_back(pos);
+			}
+		}
+	} else {
+		// the count is small next to the group, so rejection sampling is
+		// cheaper than shuffling the whole table
+		while ((int)chosen.size() < count) {
+			int pos = 1 + rand_r(&randSeed) % numPeers;
+			if (memberNode->memberList.nodeId(pos) != excludeId && find(chosen.begin(), chosen.end(), pos) == chosen.end()) {
+				chosen.push_back(pos);
 			}
-			// if we have found the correct peer then we are done
+		}
+	}
+	return chosen;
+}
+
+void MP1Node::updateMemberHeartbeat(NodeId fromId, long heartbeat, char ttl, bool direct) {
+	// look up the member who sent the heartbeat in the membership index
+	int pos = memberNode->findMember(fromId);
+
+	if (pos >= 0) {
+		// update if the received heartbeat is later than the current heartbeat in the table
+		if (heartbeat > memberNode->memberList.heartbeat(pos)) {
+			memberNode->memberList.heartbeat(pos) = heartbeat;
+			memberNode->memberList.timestamp(pos) = par->getcurrtime();
+			if (memberNode->trackArrivals) {
+				memberNode->arrivalHistory[pos].recordArrival(par->getcurrtime());
+			}
+			if (par->DETECTOR == HEARTBEAT_DETECTOR) {
+				memberNode->armExpiry(pos, par->getcurrtime() + TREMOVE + 1);
+			}
+			// a flooded heartbeat reached every member straight from its
+			// sender, so only those heard second hand are changes to pass on
+			if (par->HEARTBEAT_DELTA && (!direct || par->DISSEMINATION == GOSSIP)) {
+				memberNode->touchMember(pos);
+			}
+			sendReceivedHeartbeatToPeers(fromId, heartbeat, ttl);
+		}
+		return;
+	}
+
+	// otherwise, this is a new peer so we need to add it
+	MemberListEntry newPeer = MemberListEntry(fromId.getid(), fromId.getport(), heartbeat, par->getcurrtime());
+	memberNode->addMember(newPeer, TFAIL + 1);
+	if (par->DETECTOR == HEARTBEAT_DETECTOR) {
+		memberNode->armExpiry(memberNode->memberList.size() - 1, par->getcurrtime() + TREMOVE + 1);
+	}
+	if (par->HEARTBEAT_DELTA) {
+		memberNode->touchMember(memberNode->memberList.size() - 1);
+	}
+	log->logNodeAdd(self, fromId);
+
+	// a gossiped heartbeat has to keep spreading even through members that
+	// have not heard of its sender yet, flooding reaches everyone directly
+	if (par->DISSEMINATION == GOSSIP) {
+		sendReceivedHeartbeatToPeers(fromId, heartbeat, ttl);
+	}
+}
+
+/**
+ * FUNCTION NAME: swimLoopOps
+ *
+ * DESCRIPTION: One tick of the SWIM failure detector. Every SWIM_PERIOD a random
+ * 				member is pinged; if it does not ack within SWIM_TIMEOUT, SWIM_K
+ * 				other members are asked to ping it on our behalf. A member whose
+ * 				probe is still unacked at the end of the period becomes suspect,
+ * 				and a suspect that does not refute within SWIM_SUSPECT is
+ * 				declared failed and removed
+ */
+void MP1Node::swimLoopOps() {
+	int now = par->getcurrtime();
+
+	// the direct probe went unanswered, probe indirectly
+	if (probeActive && !probeAcked && !probeIndirect && now - probeStart >= par->SWIM_TIMEOUT) {
+		probeIndirect = true;
+		vector<int> helpers = pickRandomPeers(par->SWIM_K, probeId);
+		for (vector<int>::iterator pos = helpers.begin(); pos != helpers.end(); ++pos) {
+			sendSwimMessage(memberNode->memberList.nodeId(*pos), PINGREQ, self, probeSeq, probeId);
+		}
+	}
+
+	if (now >= memberNode->pingDeadline) {
+		// the period is over and nobody vouched for the probed member
+		bool newSuspect = false;
+		if (probeActive && !probeAcked) {
+			int target = memberNode->findMember(probeId);
+			if (target >= 0 && suspects.find(probeId) == suspects.end()) {
+				applySwimUpdate(probeId, memberNode->memberList.heartbeat(target), SUSPECT);
+				newSuspect = true;
+			}
+		}
+
+		// start the next period by probing a random member, or probe a fresh
+		// suspect once more so it hears of the suspicion and can refute it
+		probeActive = false;
+		vector<int> target;
+		if (newSuspect) {
+			target.push_back(memberNode->findMember(probeId));
+		} else {
+			target = pickRandomPeers(1, NodeId());
+		}
+		if (!target.empty()) {
+			probeId = memberNode->memberList.nodeId(target[0]);
+			probeSeq++;
+			probeStart = now;
+			probeActive = true;
+			probeAcked = false;
+			probeIndirect = false;
+			sendSwimMessage(probeId, PING, self, probeSeq, NodeId());
+		}
+		memberNode->pingDeadline = now + par->SWIM_PERIOD;
+	}
+
+	// suspects that did not refute in time are declared failed
+	vector<NodeId> expired;
+	for (unordered_map<NodeId, int>::iterator it = suspects.begin(); it != suspects.end(); ++it) {
+		if (now - it->second > par->SWIM_SUSPECT) {
+			expired.push_back(it->first);
+		}
+	}
+	for (vector<NodeId>::iterator failedId = expired.begin(); failedId != expired.end(); ++failedId) {
+		int pos = memberNode->findMember(*failedId);
+		if (pos >= 0) {
+			applySwimUpdate(*failedId, memberNode->memberList.heartbeat(pos), CONFIRM);
+		} else {
+			suspects.erase(*failedId);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: recvSwimMessage
+ *
+ * DESCRIPTION: Handle a PING, PINGREQ or ACK. All three share one layout: the
+ * 				usual header with the sequence number in the heartbeat slot,
+ * 				then one more address, then the piggybacked updates.
+ * 				PING:    about = sender, extra = member to relay the ack to (or null)
+ * 				PINGREQ: about = requester, extra = member to probe
+ * 				ACK:     about = probed member, extra = member to relay to (or null)
+ */
+void MP1Node::recvSwimMessage(MessageView &view) {
+	NodeId aboutId = view.getSender();
+	long seq = view.getHeartbeat();
+	NodeId extraId;
+	if (!view.readNodeId(extraId)) {
+		return;
+	}
+
+	// merge the piggybacked updates in one pass
+	NodeId updateId;
+	long incarnation;
+	SwimStates state;
+	while (view.nextSwimUpdate(updateId, incarnation, state)) {
+		applySwimUpdate(updateId, incarnation, state);
+	}
+
+	switch (view.getType()) {
+	case PING:
+		// a ping from someone we have not heard of yet introduces them
+		if (memberNode->findMember(aboutId) < 0) {
+			applySwimUpdate(aboutId, 0, ALIVE);
+		}
+		sendSwimMessage(aboutId, ACK, self, seq, extraId);
+		break;
+	case PINGREQ:
+		// probe the member on behalf of the requester, the ack comes back via us
+		sendSwimMessage(extraId, PING, self, seq, aboutId);
+		break;
+	case ACK:
+		if (!extraId.isNull()) {
+			// we probed for someone else, pass the ack on
+			sendSwimMessage(extraId, ACK, aboutId, seq, NodeId());
+		} else if (probeActive && seq == probeSeq && aboutId == probeId) {
+			probeAcked = true;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * FUNCTION NAME: sendSwimMessage
+ *
+ * DESCRIPTION: Build a PING, PINGREQ or ACK and piggyback the newest pending
+ * 				membership updates that fit. A receiver we suspect or declared
+ * 				failed is told so first, whether or not the update is still
+ * 				pending, so that a live one refutes it. Our own pings and acks
+ * 				then carry our incarnation, which the header has no room for,
+ * 				so that whoever suspects or declared us failed at an older one
+ * 				takes us back
+ */
+void MP1Node::sendSwimMessage(NodeId toId, MsgTypes msgType, NodeId aboutId, long seq, NodeId extraId) {
+	int maxSize = maxMessageSize();
+	MessageHandler swimHandler(emulNet->ENreserve(&memberNode->addr, maxSize), maxSize);
+	swimHandler.setMessage(aboutId, (MsgTypes)msgType, seq);
+	swimHandler.addNodeId(extraId);
+
+	int numUpdates = 0;
+	bool toldReceiver = false;
+	bool toldSelf = false;
+
+	// a confirm or suspicion about the receiver goes first so it can refute
+	// quickly, even once the update is no longer pending
+	if (numUpdates < par->SWIM_PIGGYBACK && swimHandler.hasRoomFor(WIRE_MAX_SWIM_ENTRY)) {
+		unordered_map<NodeId, long>::iterator tombstone = tombstones.find(toId);
+		int pos = memberNode->findMember(toId);
+		if (tombstone != tombstones.end()) {
+			swimHandler.addSwimUpdate(toId, tombstone->second, CONFIRM);
+			toldReceiver = true;
+		} else if (pos >= 0 && suspects.find(toId) != suspects.end()) {
+			swimHandler.addSwimUpdate(toId, memberNode->memberList.heartbeat(pos), SUSPECT);
+			toldReceiver = true;
+		}
+		numUpdates += toldReceiver ? 1 : 0;
+	}
+	// then our own incarnation on the messages about us
+	if (aboutId == self && numUpdates < par->SWIM_PIGGYBACK && swimHandler.hasRoomFor(WIRE_MAX_SWIM_ENTRY)) {
+		swimHandler.addSwimUpdate(self, memberNode->heartbeat, ALIVE);
+		toldSelf = true;
+		numUpdates++;
+	}
+	// then the newest of the rest. A pending update about the receiver or
+	// about us counts as sent when it was told already
+	for (int i = (int)swimUpdates.size() - 1; i >= 0 && numUpdates < par->SWIM_PIGGYBACK && swimHandler.hasRoomFor(WIRE_MAX_SWIM_ENTRY); i--) {
+		if ((toldReceiver && swimUpdates[i].node == toId) || (toldSelf && swimUpdates[i].node == self)) {
+			swimUpdates[i].transmissionsLeft--;
+			continue;
+		}
+		swimHandler.addSwimUpdate(swimUpdates[i].node, swimUpdates[i].incarnation, swimUpdates[i].state);
+		swimUpdates[i].transmissionsLeft--;
+		numUpdates++;
+	}
+
+	// forget updates that have been piggybacked often enough
+	swimUpdates.erase(remove_if(swimUpdates.begin(), swimUpdates.end(),
+		                          [](const SwimUpdate &update) { return update.transmissionsLeft <= 0; }),
+		                swimUpdates.end());
+
+	emulNet->ENcommit(&memberNode->addr, &toId, 1, swimHandler.getMessageSize());
+}
+
+/**
+ * FUNCTION NAME: queueSwimUpdate
+ *
+ * DESCRIPTION: Queue an update for piggybacking, replacing any older update
+ * 				about the same member. Each update rides on about 3 log(N)
+ * 				messages, enough for it to reach the whole group w.h.p.
+ */
+void MP1Node::queueSwimUpdate(NodeId nodeId, long incarnation, SwimStates state) {
+	for (vector<SwimUpdate>::iterator it = swimUpdates.begin(); it != swimUpdates.end(); ++it) {
+		if (it->node == nodeId) {
+			swimUpdates.erase(it);
+			break;
+		}
+	}
+
+	SwimUpdate update;
+	update.node = nodeId;
+	update.incarnation = incarnation;
+	update.state = state;
+	update.transmissionsLeft = (int)ceil(3 * log2((double)memberNode->memberList.size() + 1));
+	swimUpdates.push_back(update);
+}
+
+/**
+ * FUNCTION NAME: applySwimUpdate
+ *
+ * DESCRIPTION: Fold an alive, suspect or confirm update into the membership
+ * 				table. Higher incarnations override lower ones, and at the same
+ * 				incarnation suspect overrides alive. Suspicion about ourselves is
+ * 				refuted by moving to a higher incarnation, or by announcing ours
+ * 				again when it is already higher. Anything that changes
+ * 				our view is queued to be passed on
+ */
+void MP1Node::applySwimUpdate(NodeId nodeId, long incarnation, SwimStates state) {
+	int now = par->getcurrtime();
+
+	if (nodeId == self) {
+		// refute by moving past the incarnation suspected. A suspicion of an
+		// older one means the sender missed our last refutation, repeat it
+		if (state != ALIVE) {
+			if (incarnation >= memberNode->heartbeat) {
+				memberNode->heartbeat = incarnation + 1;
+				memberNode->memberList.heartbeat(0) = memberNode->heartbeat;
+			}
+			queueSwimUpdate(self, memberNode->heartbeat, ALIVE);
+		}
+		return;
+	}
+
+	// a member declared failed only comes back with a newer incarnation
+	unordered_map<NodeId, long>::iterator tombstone = tombstones.find(nodeId);
+	if (tombstone != tombstones.end()) {
+		if (incarnation <= tombstone->second) {
+			return;
+		}
+		tombstones.erase(tombstone);
+	}
+
+	int pos = memberNode->findMember(nodeId);
+	if (pos < 0) {
+		if (state == CONFIRM) {
+			tombstones[nodeId] = incarnation;
 			return;
 		}
+		memberNode->addMember(MemberListEntry(nodeId.getid(), nodeId.getport(), incarnation, now));
+		log->logNodeAdd(self, nodeId);
+		if (state == SUSPECT) {
+			suspects[nodeId] = now;
+		}
+		queueSwimUpdate(nodeId, incarnation, state);
+		return;
 	}
 
-	// otherwise, we have traversed all members, so we need to add this peer
-	int fromId = *(int *)(&fromAddr->addr);
-	int fromPort = *(short *)(&fromAddr->addr[4]);
-	MemberListEntry newPeer = MemberListEntry(fromId, fromPort, heartbeat, par->getcurrtime());
-	memberNode->memberList.push_back(newPeer);
-	log->logNodeAdd(&memberNode->addr, fromAddr);
+	bool suspected = suspects.find(nodeId) != suspects.end();
+	switch (state) {
+	case ALIVE:
+		if (incarnation > memberNode->memberList.heartbeat(pos)) {
+			memberNode->memberList.heartbeat(pos) = incarnation;
+			memberNode->memberList.timestamp(pos) = now;
+			suspects.erase(nodeId);
+			queueSwimUpdate(nodeId, incarnation, ALIVE);
+		}
+		break;
+	case SUSPECT:
+		if (incarnation > memberNode->memberList.heartbeat(pos) || (incarnation == memberNode->memberList.heartbeat(pos) && !suspected)) {
+			memberNode->memberList.heartbeat(pos) = incarnation;
+			memberNode->memberList.timestamp(pos) = now;
+			suspects[nodeId] = now;
+			queueSwimUpdate(nodeId, incarnation, SUSPECT);
+		}
+		break;
+	case CONFIRM:
+		// a confirm the member already refuted must not remove it again
+		if (incarnation >= memberNode->memberList.heartbeat(pos)) {
+			queueSwimUpdate(nodeId, incarnation, CONFIRM);
+			removeSwimMember(nodeId);
+		}
+		break;
+	}
+}
+
+/**
+ * FUNCTION NAME: removeSwimMember
+ *
+ * DESCRIPTION: Drop a member declared failed and remember its incarnation
+ */
+void MP1Node::removeSwimMember(NodeId nodeId) {
+	int pos = memberNode->findMember(nodeId);
+	tombstones[nodeId] = memberNode->memberList.heartbeat(pos);
+	suspects.erase(nodeId);
+	log->logNodeRemove(self, nodeId);
+	memberNode->removeMember(pos);
 }
@@ -14,47 +14,46 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "Message.h"
 
 /**
  * Macros
  */
 #define TREMOVE 20
 #define TFAIL 5
+// a digest only carries entries refreshed within this many time units, so
+// members that are about to be removed are not brought back by stale gossip
+#define TDIGEST (TREMOVE / 2)
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
  */
 
 /**
- * Message Types
+ * STRUCT NAME: SwimUpdate
+ *
+ * DESCRIPTION: A membership update waiting to be piggybacked on SWIM messages
  */
-enum MsgTypes{
-    JOINREQ,
-    JOINREP,
-    HEARTBEAT
-};
+typedef struct SwimUpdate {
+	NodeId node;
+	long incarnation;
+	SwimStates state;
+	// number of messages this update still rides on
+	int transmissionsLeft;
+}SwimUpdate;
 
 /**
- * STRUCT NAME: MessageHdr
+ * STRUCT NAME: DeltaPeer
  *
- * DESCRIPTION: Header and content of a message
+ * DESCRIPTION: How far a member and this node have caught up with each
+ * 				other's membership table changes, in local versions
  */
-typedef struct MessageHdr {
-	enum MsgTypes msgType;
-}MessageHdr;
-
-class MessageHandler {
-private:
-  MessageHdr *msg;
-  size_t msgSize;
-public:
-  MessageHandler();
-  ~MessageHandler();
-
-  void setMessage(Address *msgAddr, MsgTypes &&msgType, long msgHeartbeat);
-  MessageHdr* getMessage() { return msg; }
-  size_t getMessageSize() { return msgSize; }
-};
+typedef struct DeltaPeer {
+	// the member has all of our changes up to this version
+	long acked;
+	// we have all of the member's changes up to this version
+	long seen;
+}DeltaPeer;
 
 /**
  * CLASS NAME: MP1Node
@@ -67,7 +66,43 @@ private:
 	Log *log;
 	Params *par;
 	Member *memberNode;
+	// this node, as memberNode->addr
+	NodeId self;
 	char NULLADDR[6];
+	// SWIM failure detector state: the member probed this period, when the
+	// probe started and whether it has been acked
+	NodeId probeId;
+	long probeSeq;
+	int probeStart;
+	bool probeActive;
+	bool probeAcked;
+	// whether other members were asked to probe it
+	bool probeIndirect;
+	// members currently suspected, mapped to the time suspicion started
+	unordered_map<NodeId, int> suspects;
+	// incarnation at which members were declared failed, so stale updates
+	// cannot bring them back
+	unordered_map<NodeId, long> tombstones;
+	// updates still to be piggybacked, newest last
+	vector<SwimUpdate> swimUpdates;
+	// destinations of the message being multicast, reused between sends
+	vector<NodeId> peerIds;
+	// keys of the members whose expiry timers fired, reused between rounds
+	vector<long long> expiredKeys;
+	vector<size_t> expiredPositions;
+	// delta dissemination state of each member
+	unordered_map<NodeId, DeltaPeer> deltaPeers;
+	// members the deltas of a round go to, and the entries of one delta
+	vector<int> deltaTargets;
+	vector<int> deltaEntries;
+	// members we have missed heartbeats of, named in the first delta to each
+	// member in a round
+	vector<int> deltaRequests;
+	// table positions of the entries fresh enough for a digest, reused
+	// between rounds
+	vector<int> freshPositions;
+	// state of this node's random number generator
+	unsigned int randSeed;
 
 public:
 	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
@@ -78,6 +113,7 @@ public:
 	int recvLoop();
 	static int enqueueWrapper(void *env, char *buff, int size);
 	void nodeStart(char *servaddrstr, short serverport);
+	void nodeRestart(Address *joinaddr);
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
 	int finishUpThisNode();
@@ -90,8 +126,26 @@ public:
 	void initMemberListTable(Member *memberNode);
 	void printAddress(Address *addr);
   void sendHeartbeatToPeers();
-  void sendReceivedHeartbeatToPeers(Address *receivedAddr, long receivedHeartbeat);
-  void updateMemberHeartbeat(Address *fromAddr, long heartbeat);
+  void sendReceivedHeartbeatToPeers(NodeId receivedId, long receivedHeartbeat, char ttl);
+  void sendToRandomPeers(MessageHandler &handler, int fanout);
+  void sendToAllPeers(MessageHandler &handler);
+  void sendDigestToPeers();
+  void mergeDigest(MessageView &view);
+  void sendDeltaToPeers();
+  void recvDelta(MessageView &view);
+  vector<int> pickRandomPeers(int count, NodeId excludeId);
+  void sendJoinReply(NodeId joinId);
+  int maxMessageSize();
+  void swimLoopOps();
+  void recvSwimMessage(MessageView &view);
+  void sendSwimMessage(NodeId toId, MsgTypes msgType, NodeId aboutId, long seq, NodeId extraId);
+  void queueSwimUpdate(NodeId nodeId, long incarnation, SwimStates state);
+  void applySwimUpdate(NodeId nodeId, long incarnation, SwimStates state);
+  void removeSwimMember(NodeId nodeId);
+  int nextDeadline();
+  bool hasExpired(size_t pos);
+  void removeExpiredMember(size_t pos);
+  void updateMemberHeartbeat(NodeId fromId, long heartbeat, char ttl, bool direct = false);
 	virtual ~MP1Node();
 };
 
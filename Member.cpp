@@ -11,49 +11,22 @@
  */
 q_elt::q_elt(void *elt, int size): elt(elt), size(size) {}
 
-/**
- * Copy constructor
- */
-Address::Address(const Address &anotherAddress) {
-	// strcpy(addr, anotherAddress.addr);
-	memcpy(&addr, &anotherAddress.addr, sizeof(addr));
-}
-
-/**
- * Assignment operator overloading
- */
-Address& Address::operator =(const Address& anotherAddress) {
-	// strcpy(addr, anotherAddress.addr);
-	memcpy(&addr, &anotherAddress.addr, sizeof(addr));
-	return *this;
-}
-
-/**
- * Compare two Address objects
- * Return true/non-zero if they have the same ip address and port number 
- * Return false/zero if they are different 
- */
-bool Address::operator ==(const Address& anotherAddress) {
-	return !memcmp(this->addr, anotherAddress.addr, sizeof(this->addr));
-}
-
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): nodeId(id, port), heartbeat(heartbeat), timestamp(timestamp) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): nodeId(id, port) {}
 
 /**
  * Copy constructor
  */
 MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->heartbeat = anotherMLE.heartbeat;
-	this->id = anotherMLE.id;
-	this->port = anotherMLE.port;
+	this->nodeId = anotherMLE.nodeId;
 	this->timestamp = anotherMLE.timestamp;
 }
 
@@ -63,8 +36,7 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE) {
 	MemberListEntry temp(anotherMLE);
 	swap(heartbeat, temp.heartbeat);
-	swap(id, temp.id);
-	swap(port, temp.port);
+	swap(nodeId, temp.nodeId);
 	swap(timestamp, temp.timestamp);
 	return *this;
 }
@@ -75,7 +47,7 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
  * DESCRIPTION: getter
  */
 int MemberListEntry::getid() {
-	return id;
+	return nodeId.getid();
 }
 
 /**
@@ -84,7 +56,7 @@ int MemberListEntry::getid() {
  * DESCRIPTION: getter
  */
 short MemberListEntry::getport() {
-	return port;
+	return nodeId.getport();
 }
 
 /**
@@ -111,7 +83,7 @@ long MemberListEntry::gettimestamp() {
  * DESCRIPTION: setter
  */
 void MemberListEntry::setid(int id) {
-	this->id = id;
+	this->nodeId = NodeId(id, nodeId.getport());
 }
 
 /**
@@ -120,7 +92,7 @@ void MemberListEntry::setid(int id) {
  * DESCRIPTION: setter
  */
 void MemberListEntry::setport(short port) {
-	this->port = port;
+	this->nodeId = NodeId(nodeId.getid(), port);
 }
 
 /**
@@ -151,10 +123,16 @@ Member::Member(const Member &anotherMember) {
 	this->bFailed = anotherMember.bFailed;
 	this->nnb = anotherMember.nnb;
 	this->heartbeat = anotherMember.heartbeat;
-	this->pingCounter = anotherMember.pingCounter;
+	this->pingDeadline = anotherMember.pingDeadline;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
-	this->myPos = anotherMember.myPos;
+	this->trackArrivals = anotherMember.trackArrivals;
+	this->arrivalHistory = anotherMember.arrivalHistory;
+	this->expiryWheel = anotherMember.expiryWheel;
+	this->expiryTimers = anotherMember.expiryTimers;
+	this->version = anotherMember.version;
+	this->versions = anotherMember.versions;
+	this->changeLog = anotherMember.changeLog;
 	this->mp1q = anotherMember.mp1q;
 }
 
@@ -168,10 +146,173 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->bFailed = anotherMember.bFailed;
 	this->nnb = anotherMember.nnb;
 	this->heartbeat = anotherMember.heartbeat;
-	this->pingCounter = anotherMember.pingCounter;
+	this->pingDeadline = anotherMember.pingDeadline;
 	this->timeOutCounter = anotherMember.timeOutCounter;
 	this->memberList = anotherMember.memberList;
-	this->myPos = anotherMember.myPos;
+	this->trackArrivals = anotherMember.trackArrivals;
+	this->arrivalHistory = anotherMember.arrivalHistory;
+	this->expiryWheel = anotherMember.expiryWheel;
+	this->expiryTimers = anotherMember.expiryTimers;
+	this->version = anotherMember.version;
+	this->versions = anotherMember.versions;
+	this->changeLog = anotherMember.changeLog;
 	this->mp1q = anotherMember.mp1q;
 	return *this;
 }
+
+/**
+ * FUNCTION NAME: findMember
+ *
+ * DESCRIPTION: Returns the position of the membership table entry of the
+ * 				given node, or -1 if the member is not in the table
+ */
+int Member::findMember(NodeId nodeId) {
+	return memberList.find(nodeId);
+}
+
+/**
+ * FUNCTION NAME: addMember
+ *
+ * DESCRIPTION: Appends an entry to the membership table and indexes it. When
+ * 				arrivals are tracked, its arrival history starts out with one
+ * 				interval of expectedInterval
+ */
+void Member::addMember(const MemberListEntry &entry, int expectedInterval) {
+	memberList.push(entry.nodeId, entry.heartbeat, entry.timestamp);
+	if (trackArrivals) {
+		arrivalHistory.push_back(ArrivalWindow(entry.timestamp, expectedInterval));
+	}
+	expiryTimers.push_back(-1);
+	versions.push_back(0);
+}
+
+/**
+ * FUNCTION NAME: removeMember
+ *
+ * DESCRIPTION: Removes the entry at position pos in O(1) by moving the last
+ * 				entry into its slot. The order of the remaining entries is
+ * 				otherwise preserved, so the entry at position 0 stays put.
+ */
+void Member::removeMember(size_t pos) {
+	if (expiryTimers[pos] >= 0) {
+		expiryWheel.cancel(expiryTimers[pos]);
+	}
+	size_t last = memberList.size() - 1;
+	memberList.remove(pos);
+	if (pos != last) {
+		if (trackArrivals) {
+			arrivalHistory[pos] = arrivalHistory[last];
+		}
+		expiryTimers[pos] = expiryTimers[last];
+		versions[pos] = versions[last];
+	}
+	if (trackArrivals) {
+		arrivalHistory.pop_back();
+	}
+	expiryTimers.pop_back();
+	versions.pop_back();
+}
+
+/**
+ * FUNCTION NAME: clearMembers
+ *
+ * DESCRIPTION: Empties the membership table, its index and its timers
+ */
+void Member::clearMembers() {
+	memberList.clear();
+	arrivalHistory.clear();
+	expiryWheel.clear();
+	expiryTimers.clear();
+	versions.clear();
+	changeLog.clear();
+}
+
+/**
+ * FUNCTION NAME: armExpiry
+ *
+ * DESCRIPTION: Sets the entry at position pos to expire at deadline, in
+ * 				place of any deadline it had
+ */
+void Member::armExpiry(size_t pos, long deadline) {
+	if (expiryTimers[pos] >= 0) {
+		expiryWheel.rearm(expiryTimers[pos], deadline);
+	} else {
+		expiryTimers[pos] = expiryWheel.arm(deadline, memberList.nodeId(pos).value);
+	}
+}
+
+/**
+ * FUNCTION NAME: touchMember
+ *
+ * DESCRIPTION: Records a change to the entry at position pos under the next
+ * 				local version. Superseded changes and those of removed entries
+ * 				are dropped from changeLog once it holds twice as many changes
+ * 				as there are entries, so it stays in version order and in
+ * 				O(size of the table)
+ */
+void Member::touchMember(size_t pos) {
+	versions[pos] = ++version;
+	changeLog.push_back(make_pair(version, memberList.nodeId(pos)));
+	if (changeLog.size() < 2 * memberList.size() + 64) {
+		return;
+	}
+	size_t kept = 0;
+	for (size_t i = 0; i < changeLog.size(); i++) {
+		int entry = memberList.find(changeLog[i].second);
+		if (entry >= 0 && versions[entry] == changeLog[i].first) {
+			changeLog[kept++] = changeLog[i];
+		}
+	}
+	changeLog.resize(kept);
+}
+
+/**
+ * Constructor
+ */
+ArrivalWindow::ArrivalWindow(long firstArrival, int expectedInterval): lastArrival(firstArrival), sum(0), sumSquares(0), head(0), count(0) {
+	// seed the window so phi is defined before the second heartbeat
+	recordArrival(firstArrival + expectedInterval);
+	lastArrival = firstArrival;
+}
+
+/**
+ * FUNCTION NAME: recordArrival
+ *
+ * DESCRIPTION: Add the interval since the previous arrival, evicting the
+ * 				oldest one once the window is full
+ */
+void ArrivalWindow::recordArrival(long now) {
+	long interval = min(now - lastArrival, (long)USHRT_MAX);
+	if (count == PHI_WINDOW) {
+		sum -= intervals[head];
+		sumSquares -= (long)intervals[head] * intervals[head];
+	} else {
+		count++;
+	}
+	intervals[head] = (unsigned short)interval;
+	sum += interval;
+	sumSquares += interval * interval;
+	head = (head + 1) % PHI_WINDOW;
+	lastArrival = now;
+}
+
+/**
+ * FUNCTION NAME: phi
+ *
+ * DESCRIPTION: Suspicion level that the member has failed given the time since
+ * 				its last heartbeat, -log10 of the probability that a heartbeat
+ * 				this late still arrives under a normal model of the window.
+ * 				The tail probability uses the logistic approximation of the
+ * 				normal CDF, which stays finite for large deviations
+ */
+double ArrivalWindow::phi(long now, double minStdDev) {
+	double mean = (double)sum / count;
+	double variance = (double)sumSquares / count - mean * mean;
+	double stdDev = max(sqrt(max(variance, 0.0)), minStdDev);
+	double y = ((double)(now - lastArrival) - mean) / stdDev;
+	double e = exp(-y * (1.5976 + 0.070566 * y * y));
+	if (now - lastArrival > mean) {
+		return -log10(e / (1.0 + e));
+	}
+	return -log10(1.0 - 1.0 / (1.0 + e));
+}
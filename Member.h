@@ -8,6 +8,12 @@
 #define MEMBER_H_
 
 #include "stdincludes.h"
+#include "NodeId.h"
+#include "TimerWheel.h"
+#include "MemberStore.h"
+
+// number of inter-arrival times each ArrivalWindow remembers
+#define PHI_WINDOW 16
 
 /**
  * CLASS NAME: q_elt
@@ -30,11 +36,15 @@ class Address {
 public:
 	char addr[6];
 	Address() {}
-	// Copy constructor
-	Address(const Address &anotherAddress);
-	 // Overloaded = operator
-	Address& operator =(const Address &anotherAddress);
-	bool operator ==(const Address &anotherAddress);
+	explicit Address(NodeId nodeId) {
+		int id = nodeId.getid();
+		short port = nodeId.getport();
+		memcpy(&addr[0], &id, sizeof(int));
+		memcpy(&addr[4], &port, sizeof(short));
+	}
+	bool operator ==(const Address &anotherAddress) const {
+		return getNodeId() == anotherAddress.getNodeId();
+	}
 
   // overloaded constructor
 	Address(string address) {
@@ -58,6 +68,15 @@ public:
 	void init() {
 		memset(&addr, 0, sizeof(addr));
 	}
+
+	// the id and port packed into one integer
+	NodeId getNodeId() const {
+		int id;
+		short port;
+		memcpy(&id, &addr[0], sizeof(int));
+		memcpy(&port, &addr[4], sizeof(short));
+		return NodeId(id, port);
+	}
 };
 
 /**
@@ -67,13 +86,12 @@ public:
  */
 class MemberListEntry {
 public:
-	int id;
-	short port;
+	NodeId nodeId;
 	long heartbeat;
 	long timestamp;
 	MemberListEntry(int id, short port, long heartbeat, long timestamp);
 	MemberListEntry(int id, short port);
-	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry(): heartbeat(0), timestamp(0) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry& operator =(const MemberListEntry &anotherMLE);
 	int getid();
@@ -86,6 +104,26 @@ public:
 	void settimestamp(long timestamp);
 };
 
+/**
+ * CLASS NAME: ArrivalWindow
+ *
+ * DESCRIPTION: Fixed-size ring of the latest heartbeat inter-arrival times of
+ * 				one member, with running sums so the phi accrual suspicion
+ * 				level can be computed in O(1)
+ */
+class ArrivalWindow {
+public:
+	long lastArrival;
+	long sum;
+	long sumSquares;
+	unsigned short intervals[PHI_WINDOW];
+	unsigned char head;
+	unsigned char count;
+	ArrivalWindow(long firstArrival, int expectedInterval);
+	void recordArrival(long now);
+	double phi(long now, double minStdDev);
+};
+
 /**
  * CLASS NAME: Member
  *
@@ -106,24 +144,45 @@ public:
 	int nnb;
 	// the node's own heartbeat
 	long heartbeat;
-	// counter for next ping
-	int pingCounter;
+	// time of the next heartbeat or SWIM probe, -1 until the node's first
+	// round in the group
+	int pingDeadline;
 	// counter for ping timeout
 	int timeOutCounter;
-	// Membership table
-	vector<MemberListEntry> memberList;
-	// My position in the membership table
-	vector<MemberListEntry>::iterator myPos;
+	// Membership table, indexed by the NodeId of each entry
+	MemberStore memberList;
+	// whether arrivalHistory is kept, only phi accrual looks at it
+	bool trackArrivals;
+	// Heartbeat arrival history of each entry, kept at the same position as
+	// the entry in memberList
+	vector<ArrivalWindow> arrivalHistory;
+	// Expiry timers of the entries, keyed by the packed NodeId, and the
+	// handle of each entry's timer at its position in memberList, -1 while
+	// it has none
+	TimerWheel expiryWheel;
+	vector<int> expiryTimers;
+	// Local version of the latest change to the table, the version of each
+	// entry's latest change at its position in memberList, and the changes
+	// in the order they were made, as (version, member)
+	long version;
+	vector<long> versions;
+	vector<pair<long, NodeId> > changeLog;
 	// Queue for failure detection messages
 	queue<q_elt> mp1q;
 	/**
 	 * Constructor
 	 */
-	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0) {}
+	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingDeadline(-1), timeOutCounter(0), trackArrivals(false), version(0) {}
 	// copy constructor
 	Member(const Member &anotherMember);
 	// Assignment operator overloading
 	Member& operator =(const Member &anotherMember);
+	int findMember(NodeId nodeId);
+	void addMember(const MemberListEntry &entry, int expectedInterval = 1);
+	void removeMember(size_t pos);
+	void clearMembers();
+	void armExpiry(size_t pos, long deadline);
+	void touchMember(size_t pos);
 	virtual ~Member() {}
 };
 
@@ -0,0 +1,451 @@
+/**********************************
+ * FILE NAME: MemberStore.cpp
+ *
+ * DESCRIPTION: Definition of MemberStore class functions
+ **********************************/
+
+#include "MemberStore.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STORE_X86 1
+#endif
+
+/**
+ * FUNCTION NAME: appendMatches
+ *
+ * DESCRIPTION: Writes base plus the index of every bit set in bits, lowest
+ * 				first, from out on, and returns where the next one goes
+ */
+static inline int *appendMatches(unsigned int bits, size_t base, int *out) {
+	while ( bits != 0 ) {
+		*out++ = base + __builtin_ctz(bits);
+		bits &= bits - 1;
+	}
+	return out;
+}
+
+/**
+ * FUNCTION NAME: selectScalar
+ *
+ * DESCRIPTION: Writes the positions in [first, end) whose timestamp lies
+ * 				strictly between after and before from out on, and returns
+ * 				where the next one goes
+ */
+static int *selectScalar(const int *timestamps, size_t first, size_t end, int after, int before, int *out) {
+	for ( size_t pos = first; pos < end; pos++ ) {
+		if ( timestamps[pos] > after && timestamps[pos] < before ) {
+			*out++ = pos;
+		}
+	}
+	return out;
+}
+
+#ifdef STORE_X86
+/**
+ * FUNCTION NAME: detectKernel
+ *
+ * DESCRIPTION: AVX2 when the processor has it, SSE2 is always there on x86
+ */
+static scanKERNEL detectKernel() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? SCAN_AVX2 : SCAN_SSE2;
+}
+
+/**
+ * FUNCTION NAME: selectSse2
+ *
+ * DESCRIPTION: selectScalar four timestamps at a time
+ */
+static int *selectSse2(const int *timestamps, size_t first, size_t end, int after, int before, int *out) {
+	size_t pos = min((first + 3) & ~(size_t)3, end);
+	out = selectScalar(timestamps, first, pos, after, before, out);
+	__m128i low = _mm_set1_epi32(after);
+	__m128i high = _mm_set1_epi32(before);
+	for ( ; pos + 4 <= end; pos += 4 ) {
+		__m128i value = _mm_load_si128((const __m128i *)(timestamps + pos));
+		__m128i inside = _mm_and_si128(_mm_cmpgt_epi32(value, low), _mm_cmpgt_epi32(high, value));
+		out = appendMatches(_mm_movemask_ps(_mm_castsi128_ps(inside)), pos, out);
+	}
+	return selectScalar(timestamps, pos, end, after, before, out);
+}
+
+/**
+ * FUNCTION NAME: selectAvx2
+ *
+ * DESCRIPTION: selectScalar eight timestamps at a time, only called when the
+ * 				processor has AVX2
+ */
+__attribute__((target("avx2")))
+static int *selectAvx2(const int *timestamps, size_t first, size_t end, int after, int before, int *out) {
+	size_t pos = min((first + 7) & ~(size_t)7, end);
+	out = selectScalar(timestamps, first, pos, after, before, out);
+	__m256i low = _mm256_set1_epi32(after);
+	__m256i high = _mm256_set1_epi32(before);
+	for ( ; pos + 8 <= end; pos += 8 ) {
+		__m256i value = _mm256_load_si256((const __m256i *)(timestamps + pos));
+		__m256i inside = _mm256_and_si256(_mm256_cmpgt_epi32(value, low), _mm256_cmpgt_epi32(high, value));
+		out = appendMatches(_mm256_movemask_ps(_mm256_castsi256_ps(inside)), pos, out);
+	}
+	return selectScalar(timestamps, pos, end, after, before, out);
+}
+#endif
+
+/**
+ * Constructor
+ */
+MemberStore::MemberStore(): nodeIds(NULL), heartbeats(NULL), timestamps(NULL), count(0), capacity(0), ctrl(NULL), slots(NULL), numBuckets(0), growthLeft(0), kernel(bestKernel()) {}
+
+/**
+ * Copy constructor
+ */
+MemberStore::MemberStore(const MemberStore &anotherStore): nodeIds(NULL), heartbeats(NULL), timestamps(NULL), count(0), capacity(0), ctrl(NULL), slots(NULL), numBuckets(0), growthLeft(0), kernel(anotherStore.kernel) {
+	copyFrom(anotherStore);
+}
+
+/**
+ * Assignment operator overloading
+ */
+MemberStore& MemberStore::operator =(const MemberStore &anotherStore) {
+	if ( this != &anotherStore ) {
+		release();
+		kernel = anotherStore.kernel;
+		copyFrom(anotherStore);
+	}
+	return *this;
+}
+
+/**
+ * Destructor
+ */
+MemberStore::~MemberStore() {
+	release();
+}
+
+/**
+ * FUNCTION NAME: allocColumn
+ *
+ * DESCRIPTION: STORE_ALIGN aligned memory for a column or the index
+ */
+void *MemberStore::allocColumn(size_t bytes) {
+	void *column;
+	if ( posix_memalign(&column, STORE_ALIGN, max(bytes, (size_t)STORE_ALIGN)) != 0 ) {
+		perror("posix_memalign");
+		exit(1);
+	}
+	return column;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Frees the columns and the index
+ */
+void MemberStore::release() {
+	free(nodeIds);
+	free(heartbeats);
+	free(timestamps);
+	free(ctrl);
+	free(slots);
+	nodeIds = NULL;
+	heartbeats = NULL;
+	timestamps = NULL;
+	ctrl = NULL;
+	slots = NULL;
+	count = capacity = numBuckets = growthLeft = 0;
+}
+
+/**
+ * FUNCTION NAME: copyFrom
+ *
+ * DESCRIPTION: Copies the entries of another store into this empty one
+ */
+void MemberStore::copyFrom(const MemberStore &anotherStore) {
+	capacity = anotherStore.count;
+	count = anotherStore.count;
+	nodeIds = (NodeId *)allocColumn(capacity * sizeof(NodeId));
+	heartbeats = (long *)allocColumn(capacity * sizeof(long));
+	timestamps = (int *)allocColumn(capacity * sizeof(int));
+	if ( count > 0 ) {
+		memcpy(nodeIds, anotherStore.nodeIds, count * sizeof(NodeId));
+		memcpy(heartbeats, anotherStore.heartbeats, count * sizeof(long));
+		memcpy(timestamps, anotherStore.timestamps, count * sizeof(int));
+		rebuildIndex(anotherStore.numBuckets);
+	}
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Doubles the room of every column
+ */
+void MemberStore::grow() {
+	size_t newCapacity = max((size_t)STORE_GROUP, 2 * capacity);
+	NodeId *newNodeIds = (NodeId *)allocColumn(newCapacity * sizeof(NodeId));
+	long *newHeartbeats = (long *)allocColumn(newCapacity * sizeof(long));
+	int *newTimestamps = (int *)allocColumn(newCapacity * sizeof(int));
+	if ( count > 0 ) {
+		memcpy(newNodeIds, nodeIds, count * sizeof(NodeId));
+		memcpy(newHeartbeats, heartbeats, count * sizeof(long));
+		memcpy(newTimestamps, timestamps, count * sizeof(int));
+	}
+	free(nodeIds);
+	free(heartbeats);
+	free(timestamps);
+	nodeIds = newNodeIds;
+	heartbeats = newHeartbeats;
+	timestamps = newTimestamps;
+	capacity = newCapacity;
+}
+
+/**
+ * FUNCTION NAME: hashKey
+ *
+ * DESCRIPTION: Spreads the bits of a NodeId over the whole word, the low 7
+ * 				bits go into the control byte and the rest pick the first group
+ * 				to probe
+ */
+size_t MemberStore::hashKey(NodeId nodeId) {
+	unsigned long long hash = nodeId.value * 0x9E3779B97F4A7C15ULL;
+	return hash ^ (hash >> 29);
+}
+
+/**
+ * FUNCTION NAME: matchGroup
+ *
+ * DESCRIPTION: One bit per control byte of the group equal to byte
+ */
+unsigned int MemberStore::matchGroup(const unsigned char *group, unsigned char byte) {
+#ifdef STORE_X86
+	__m128i bytes = _mm_load_si128((const __m128i *)group);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte)));
+#else
+	unsigned int bits = 0;
+	for ( int i = 0; i < STORE_GROUP; i++ ) {
+		bits |= (unsigned int)(group[i] == byte) << i;
+	}
+	return bits;
+#endif
+}
+
+/**
+ * FUNCTION NAME: findBucket
+ *
+ * DESCRIPTION: The index bucket of the entry of the given node, or -1. Groups
+ * 				are probed at triangular distances from the first one, which
+ * 				visits them all, until one has an empty bucket
+ */
+long MemberStore::findBucket(NodeId nodeId) {
+	if ( numBuckets == 0 ) {
+		return -1;
+	}
+	size_t hash = hashKey(nodeId);
+	size_t groupMask = numBuckets / STORE_GROUP - 1;
+	size_t group = (hash >> 7) & groupMask;
+	for ( size_t step = 1; ; step++ ) {
+		const unsigned char *groupCtrl = ctrl + group * STORE_GROUP;
+		unsigned int bits = matchGroup(groupCtrl, hash & 0x7F);
+		while ( bits != 0 ) {
+			size_t bucket = group * STORE_GROUP + __builtin_ctz(bits);
+			if ( nodeIds[slots[bucket]] == nodeId ) {
+				return bucket;
+			}
+			bits &= bits - 1;
+		}
+		if ( matchGroup(groupCtrl, STORE_EMPTY) != 0 ) {
+			return -1;
+		}
+		group = (group + step) & groupMask;
+	}
+}
+
+/**
+ * FUNCTION NAME: insertBucket
+ *
+ * DESCRIPTION: Indexes the entry at position pos under nodeId, which is not
+ * 				in the index yet. Once no empty bucket can be filled without
+ * 				going over 7/8 of them, the index is rebuilt: twice as large
+ * 				when more than half of that room holds entries, else at the
+ * 				same size to clear the buckets of removed entries
+ */
+void MemberStore::insertBucket(NodeId nodeId, int pos) {
+	if ( growthLeft == 0 ) {
+		size_t limit = numBuckets / 8 * 7;
+		rebuildIndex(numBuckets == 0 ? STORE_GROUP : (2 * (size_t)pos > limit ? 2 * numBuckets : numBuckets));
+	}
+	size_t hash = hashKey(nodeId);
+	size_t groupMask = numBuckets / STORE_GROUP - 1;
+	size_t group = (hash >> 7) & groupMask;
+	for ( size_t step = 1; ; step++ ) {
+		const unsigned char *groupCtrl = ctrl + group * STORE_GROUP;
+		unsigned int bits = matchGroup(groupCtrl, STORE_EMPTY) | matchGroup(groupCtrl, STORE_DELETED);
+		if ( bits != 0 ) {
+			size_t bucket = group * STORE_GROUP + __builtin_ctz(bits);
+			if ( ctrl[bucket] == STORE_EMPTY ) {
+				growthLeft--;
+			}
+			ctrl[bucket] = hash & 0x7F;
+			slots[bucket] = pos;
+			return;
+		}
+		group = (group + step) & groupMask;
+	}
+}
+
+/**
+ * FUNCTION NAME: rebuildIndex
+ *
+ * DESCRIPTION: Indexes every entry again in an index of the given number of
+ * 				buckets
+ */
+void MemberStore::rebuildIndex(size_t buckets) {
+	free(ctrl);
+	free(slots);
+	numBuckets = buckets;
+	ctrl = (unsigned char *)allocColumn(numBuckets);
+	slots = (int *)allocColumn(numBuckets * sizeof(int));
+	memset(ctrl, STORE_EMPTY, numBuckets);
+	growthLeft = numBuckets / 8 * 7;
+	for ( size_t pos = 0; pos < count; pos++ ) {
+		insertBucket(nodeIds[pos], pos);
+	}
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: The position of the entry of the given node, or -1 if there is
+ * 				none
+ */
+int MemberStore::find(NodeId nodeId) {
+	long bucket = findBucket(nodeId);
+	return bucket < 0 ? -1 : slots[bucket];
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Appends an entry whose node is not in the store yet
+ */
+void MemberStore::push(NodeId nodeId, long heartbeat, int timestamp) {
+	if ( count == capacity ) {
+		grow();
+	}
+	nodeIds[count] = nodeId;
+	heartbeats[count] = heartbeat;
+	timestamps[count] = timestamp;
+	insertBucket(nodeId, count);
+	count++;
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Removes the entry at position pos by moving the last entry
+ * 				into its place. Its bucket becomes empty again when its group
+ * 				has an empty bucket anyway, since no probe goes past that
+ * 				group, and is marked removed otherwise
+ */
+void MemberStore::remove(size_t pos) {
+	size_t bucket = findBucket(nodeIds[pos]);
+	size_t group = bucket / STORE_GROUP;
+	if ( matchGroup(ctrl + group * STORE_GROUP, STORE_EMPTY) != 0 ) {
+		ctrl[bucket] = STORE_EMPTY;
+		growthLeft++;
+	} else {
+		ctrl[bucket] = STORE_DELETED;
+	}
+
+	size_t last = count - 1;
+	if ( pos != last ) {
+		slots[findBucket(nodeIds[last])] = pos;
+		nodeIds[pos] = nodeIds[last];
+		heartbeats[pos] = heartbeats[last];
+		timestamps[pos] = timestamps[last];
+	}
+	count--;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Removes every entry, the memory is kept
+ */
+void MemberStore::clear() {
+	count = 0;
+	if ( numBuckets > 0 ) {
+		memset(ctrl, STORE_EMPTY, numBuckets);
+		growthLeft = numBuckets / 8 * 7;
+	}
+}
+
+/**
+ * FUNCTION NAME: selectByAge
+ *
+ * DESCRIPTION: Appends to out, in order, the positions from first on of the
+ * 				entries refreshed more than minAge and at most maxAge time
+ * 				units before now. The ages only take a pass over the timestamp
+ * 				column, with the kernel setKernel picked
+ */
+void MemberStore::selectByAge(size_t first, int now, int minAge, int maxAge, vector<int> &out) {
+	if ( first >= count ) {
+		return;
+	}
+	// now - timestamp <= maxAge and now - timestamp > minAge
+	int after = now - maxAge - 1;
+	int before = now - minAge;
+	// room for every position, given back once the matches are known
+	size_t base = out.size();
+	out.resize(base + count - first);
+	int *start = &out[base];
+	int *end;
+	switch ( kernel ) {
+#ifdef STORE_X86
+	case SCAN_AVX2:
+		end = selectAvx2(timestamps, first, count, after, before, start);
+		break;
+	case SCAN_SSE2:
+		end = selectSse2(timestamps, first, count, after, before, start);
+		break;
+#endif
+	default:
+		end = selectScalar(timestamps, first, count, after, before, start);
+		break;
+	}
+	out.resize(base + (end - start));
+}
+
+/**
+ * FUNCTION NAME: setKernel
+ *
+ * DESCRIPTION: Picks the implementation of the age scan, at most the best one
+ * 				the processor runs
+ */
+void MemberStore::setKernel(scanKERNEL scanKernel) {
+	kernel = min(scanKernel, widestKernel());
+}
+
+/**
+ * FUNCTION NAME: widestKernel
+ *
+ * DESCRIPTION: The widest age scan the processor runs
+ */
+scanKERNEL MemberStore::widestKernel() {
+#ifdef STORE_X86
+	static scanKERNEL widest = detectKernel();
+	return widest;
+#else
+	return SCAN_SCALAR;
+#endif
+}
+
+/**
+ * FUNCTION NAME: bestKernel
+ *
+ * DESCRIPTION: The age scan a table starts with: AVX2 when the processor has
+ * 				it, the scalar loop otherwise. The SSE2 scan is slower than the
+ * 				scalar loop in the default -O0 build up to thousands of members
+ */
+scanKERNEL MemberStore::bestKernel() {
+	return widestKernel() == SCAN_AVX2 ? SCAN_AVX2 : SCAN_SCALAR;
+}
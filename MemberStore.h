@@ -0,0 +1,83 @@
+/**********************************
+ * FILE NAME: MemberStore.h
+ *
+ * DESCRIPTION: Header file of MemberStore class
+ **********************************/
+
+#ifndef _MEMBERSTORE_H_
+#define _MEMBERSTORE_H_
+
+#include "stdincludes.h"
+#include "NodeId.h"
+
+/*
+ * Macros
+ */
+// alignment of every column, a cache line and more than the widest vector
+// load of the scans
+#define STORE_ALIGN 64
+// index buckets looked at per probe, one SSE2 register of control bytes
+#define STORE_GROUP 16
+// control byte of a bucket that never held an entry, and of one whose entry
+// was removed. A full bucket holds the low 7 bits of its key's hash
+#define STORE_EMPTY 0x80
+#define STORE_DELETED 0xFE
+
+// implementations of the age scan
+enum scanKERNEL { SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+
+/**
+ * CLASS NAME: MemberStore
+ *
+ * DESCRIPTION: The membership table as a structure of arrays. The NodeId of
+ * 				each entry, its heartbeat and the time it was last refreshed
+ * 				each sit in their own STORE_ALIGN aligned array, so a scan over
+ * 				one of them streams through memory with vector loads. Entries are
+ * 				found by address through an open addressing index that keeps
+ * 				one control byte and a position per bucket, and compares the
+ * 				control bytes of STORE_GROUP buckets at once. Removal moves the
+ * 				last entry into the freed position
+ */
+class MemberStore {
+private:
+	NodeId *nodeIds;
+	long *heartbeats;
+	int *timestamps;
+	size_t count;
+	size_t capacity;
+	// the index, numBuckets is a multiple of STORE_GROUP and a power of two
+	unsigned char *ctrl;
+	int *slots;
+	size_t numBuckets;
+	// empty buckets that can still be filled before the index is rebuilt
+	size_t growthLeft;
+	scanKERNEL kernel;
+	static void *allocColumn(size_t bytes);
+	static size_t hashKey(NodeId nodeId);
+	static unsigned int matchGroup(const unsigned char *group, unsigned char byte);
+	void grow();
+	long findBucket(NodeId nodeId);
+	void insertBucket(NodeId nodeId, int pos);
+	void rebuildIndex(size_t buckets);
+	void release();
+	void copyFrom(const MemberStore &anotherStore);
+public:
+	MemberStore();
+	MemberStore(const MemberStore &anotherStore);
+	MemberStore& operator =(const MemberStore &anotherStore);
+	~MemberStore();
+	size_t size() { return count; }
+	NodeId nodeId(size_t pos) { return nodeIds[pos]; }
+	long &heartbeat(size_t pos) { return heartbeats[pos]; }
+	int &timestamp(size_t pos) { return timestamps[pos]; }
+	int find(NodeId nodeId);
+	void push(NodeId nodeId, long heartbeat, int timestamp);
+	void remove(size_t pos);
+	void clear();
+	void selectByAge(size_t first, int now, int minAge, int maxAge, vector<int> &out);
+	void setKernel(scanKERNEL scanKernel);
+	static scanKERNEL widestKernel();
+	static scanKERNEL bestKernel();
+};
+
+#endif /* _MEMBERSTORE_H_ */
@@ -0,0 +1,164 @@
+/**********************************
+ * FILE NAME: Message.cpp
+ *
+ * DESCRIPTION: Definition of MessageHandler and MessageView class functions
+ **********************************/
+
+#include "Message.h"
+
+/**
+ * Constructor
+ */
+MessageHandler::MessageHandler(char *buffer, size_t capacity): msg(buffer), msgSize(0), msgCapacity(capacity), prevId(0), prevValue(0) {}
+
+/**
+ * FUNCTION NAME: setMessage
+ *
+ * DESCRIPTION: Start the message over with a header. Entries added after it
+ * 				are delta encoded against its address and heartbeat
+ */
+void MessageHandler::setMessage(NodeId msgNode, MsgTypes &&msgType, long msgHeartbeat, char msgTtl) {
+	msgSize = 0;
+	msg[msgSize++] = (char)(WIRE_VERSION << 4 | msgType);
+	putNodeId(msgNode);
+	msg[msgSize++] = msgTtl;
+	putSigned(msgHeartbeat);
+	prevId = msgNode.getid();
+	prevValue = msgHeartbeat;
+}
+
+void MessageHandler::addDigestEntry(NodeId nodeId, long heartbeat) {
+	int id = nodeId.getid();
+	putSigned((long)id - prevId);
+	putVarint((unsigned short)nodeId.getport());
+	putSigned(heartbeat - prevValue);
+	prevId = id;
+	prevValue = heartbeat;
+}
+
+/**
+ * FUNCTION NAME: addVersions
+ *
+ * DESCRIPTION: The versions of a DELTA, right after its header
+ */
+void MessageHandler::addVersions(long ack, long base, long version, int numRequests) {
+	putVarint(ack);
+	putVarint(base);
+	putVarint(version);
+	putVarint(numRequests);
+}
+
+/**
+ * FUNCTION NAME: addNodeId
+ *
+ * DESCRIPTION: The extra node of a SWIM message, the null NodeId for none.
+ * 				The incarnations of the updates after it start from 0
+ */
+void MessageHandler::addNodeId(NodeId nodeId) {
+	putNodeId(nodeId);
+	prevValue = 0;
+}
+
+void MessageHandler::addSwimUpdate(NodeId nodeId, long incarnation, SwimStates state) {
+	int id = nodeId.getid();
+	putSigned((long)id - prevId);
+	putVarint((unsigned short)nodeId.getport());
+	putSigned(incarnation - prevValue);
+	msg[msgSize++] = (char)state;
+	prevId = id;
+	prevValue = incarnation;
+}
+
+/**
+ * Constructor
+ */
+MessageView::MessageView(const char *data, int size): pos((const unsigned char *)data), end((const unsigned char *)data + size), valid(false), msgType(JOINREQ), ttl(0), heartbeat(0), prevId(0), prevValue(0) {
+	unsigned long id;
+	if (pos == end || (*pos >> 4) != WIRE_VERSION || (*pos & 0xf) > DELTA) {
+		return;
+	}
+	msgType = (MsgTypes)(*pos++ & 0xf);
+	if (!getVarint(id) || !getNodeId(sender, (int)id) || pos == end) {
+		return;
+	}
+	ttl = (char)*pos++;
+	if (!getSigned(heartbeat)) {
+		return;
+	}
+	prevId = (int)id;
+	prevValue = heartbeat;
+	valid = true;
+}
+
+/**
+ * FUNCTION NAME: nextDigestEntry
+ *
+ * DESCRIPTION: Reads the next digest entry, false once there is none left
+ */
+bool MessageView::nextDigestEntry(NodeId &entryId, long &entryHeartbeat) {
+	long delta;
+	if (!valid || pos == end || !getSigned(delta)) {
+		return false;
+	}
+	prevId += (int)delta;
+	if (!getNodeId(entryId, prevId) || !getSigned(delta)) {
+		return false;
+	}
+	prevValue += delta;
+	entryHeartbeat = prevValue;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: readVersions
+ *
+ * DESCRIPTION: Reads the versions of a DELTA, which come before its entries
+ */
+bool MessageView::readVersions(long &ack, long &base, long &version, int &numRequests) {
+	unsigned long value[4];
+	if (!valid || !getVarint(value[0]) || !getVarint(value[1]) || !getVarint(value[2]) || !getVarint(value[3])) {
+		return false;
+	}
+	ack = value[0];
+	base = value[1];
+	version = value[2];
+	numRequests = (int)value[3];
+	return true;
+}
+
+/**
+ * FUNCTION NAME: readNodeId
+ *
+ * DESCRIPTION: Reads the extra node of a SWIM message, the null NodeId for
+ * 				none
+ */
+bool MessageView::readNodeId(NodeId &extraId) {
+	unsigned long id;
+	if (!valid || !getVarint(id) || !getNodeId(extraId, (int)id)) {
+		return false;
+	}
+	prevValue = 0;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: nextSwimUpdate
+ *
+ * DESCRIPTION: Reads the next piggybacked update, false once there is none
+ * 				left
+ */
+bool MessageView::nextSwimUpdate(NodeId &updateId, long &incarnation, SwimStates &state) {
+	long delta;
+	if (!valid || pos == end || !getSigned(delta)) {
+		return false;
+	}
+	prevId += (int)delta;
+	if (!getNodeId(updateId, prevId) || !getSigned(delta) || pos == end || *pos > CONFIRM) {
+		valid = false;
+		return false;
+	}
+	prevValue += delta;
+	incarnation = prevValue;
+	state = (SwimStates)*pos++;
+	return true;
+}
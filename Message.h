@@ -0,0 +1,186 @@
+/**********************************
+ * FILE NAME: Message.h
+ *
+ * DESCRIPTION: Wire format of the messages exchanged by MP1Node. Header file
+ * 				of MessageHandler, which builds a message in place, and
+ * 				MessageView, which reads one where it was received
+ **********************************/
+
+#ifndef _MESSAGE_H_
+#define _MESSAGE_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/**
+ * Macros
+ */
+// bumped whenever the layout below changes, messages of other versions are
+// ignored
+#define WIRE_VERSION 1
+// longest encodings: a varint of 64 bits takes 10 bytes, of 32 bits 5 and
+// of 16 bits 3
+#define WIRE_MAX_ADDRESS (5 + 3)
+#define WIRE_MAX_HEADER (1 + WIRE_MAX_ADDRESS + 1 + 10)
+#define WIRE_MAX_DIGEST_ENTRY (WIRE_MAX_ADDRESS + 10)
+#define WIRE_MAX_SWIM_ENTRY (WIRE_MAX_ADDRESS + 10 + 1)
+// the acknowledgement, base and version of a delta and its number of requests
+#define WIRE_MAX_VERSIONS (4 * 10)
+// the varint helpers run several times per entry, and the build does not
+// optimise, so they are inlined by force
+#define WIRE_INLINE inline __attribute__((always_inline))
+
+/*
+ * Layout, all integers as LEB128 varints, signed ones zigzag encoded:
+ *
+ * header:        version << 4 | type (1 byte), node id, port, ttl (1 byte),
+ *                heartbeat (signed)
+ * digest entry:  id - previous id (signed), port, heartbeat - previous
+ *                heartbeat (signed). Follows a HEARTBEAT or JOINREP header,
+ *                or the versions of a DELTA, the first entry is relative to
+ *                the header
+ * DELTA body:    ack, base, version and number of requests, then digest
+ *                entries. The first entries are requests, members whose
+ *                latest heartbeat the sender missed, the others the
+ *                sender's changes after base up to version. ack is the
+ *                receiver's version the sender has all changes up to
+ * SWIM body:     extra node id and port, 0 for none, then updates of
+ *                id - previous id (signed), port, incarnation - previous
+ *                incarnation (signed), state (1 byte). Follows a PING,
+ *                PINGREQ or ACK header, whose heartbeat is the sequence number
+ */
+
+/**
+ * Message Types
+ */
+enum MsgTypes{
+    JOINREQ,
+    JOINREP,
+    HEARTBEAT,
+    PING,
+    PINGREQ,
+    ACK,
+    DELTA
+};
+
+/**
+ * Member states disseminated by the SWIM failure detector
+ */
+enum SwimStates{
+    ALIVE,
+    SUSPECT,
+    CONFIRM
+};
+
+/**
+ * CLASS NAME: MessageHandler
+ *
+ * DESCRIPTION: Builds a message in a buffer owned by the caller, usually the
+ * 				space EmulNet::ENreserve set aside in the send buffer, so the
+ * 				message is never copied before it is delivered
+ */
+class MessageHandler {
+private:
+	char *msg;
+	size_t msgSize;
+	size_t msgCapacity;
+	// what the next entry is delta encoded against
+	int prevId;
+	long prevValue;
+	// seven bits per byte, low bits first, the top bit set on all but the
+	// last byte. The bytes go through a local pointer, as stores through msg
+	// could change msgSize for all the compiler knows
+	WIRE_INLINE void putVarint(unsigned long value) {
+		char *out = msg + msgSize;
+		while (value >= 0x80) {
+			*out++ = (char)(value | 0x80);
+			value >>= 7;
+		}
+		*out++ = (char)value;
+		msgSize = out - msg;
+	}
+	// zigzag encoding keeps small negative deltas short too
+	WIRE_INLINE void putSigned(long value) {
+		putVarint(((unsigned long)value << 1) ^ (unsigned long)(value >> 63));
+	}
+	WIRE_INLINE void putNodeId(NodeId nodeId) {
+		putVarint((unsigned int)nodeId.getid());
+		putVarint((unsigned short)nodeId.getport());
+	}
+public:
+	MessageHandler(char *buffer, size_t capacity);
+	void setMessage(NodeId msgNode, MsgTypes &&msgType, long msgHeartbeat, char msgTtl = 0);
+	void addDigestEntry(NodeId nodeId, long heartbeat);
+	void addVersions(long ack, long base, long version, int numRequests);
+	void addNodeId(NodeId nodeId);
+	void addSwimUpdate(NodeId nodeId, long incarnation, SwimStates state);
+	// whether numBytes more bytes fit
+	bool hasRoomFor(size_t numBytes) { return msgSize + numBytes <= msgCapacity; }
+	char *getMessage() { return msg; }
+	size_t getMessageSize() { return msgSize; }
+};
+
+/**
+ * CLASS NAME: MessageView
+ *
+ * DESCRIPTION: Reads a message in the buffer it was received in. The header
+ * 				is decoded up front, the entries after it one at a time. A
+ * 				message that is cut short or of another version is invalid
+ */
+class MessageView {
+private:
+	const unsigned char *pos;
+	const unsigned char *end;
+	bool valid;
+	MsgTypes msgType;
+	NodeId sender;
+	char ttl;
+	long heartbeat;
+	int prevId;
+	long prevValue;
+	WIRE_INLINE bool getVarint(unsigned long &value) {
+		const unsigned char *in = pos;
+		unsigned long result = 0;
+		for (int shift = 0; in < end && shift < 64; shift += 7) {
+			unsigned char byte = *in++;
+			result |= (unsigned long)(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) {
+				pos = in;
+				value = result;
+				return true;
+			}
+		}
+		valid = false;
+		return false;
+	}
+	WIRE_INLINE bool getSigned(long &value) {
+		unsigned long zigzag;
+		if (!getVarint(zigzag)) {
+			return false;
+		}
+		value = (long)(zigzag >> 1) ^ -(long)(zigzag & 1);
+		return true;
+	}
+	// reads the port that follows a node id and fills in nodeId
+	WIRE_INLINE bool getNodeId(NodeId &nodeId, int id) {
+		unsigned long port;
+		if (!getVarint(port)) {
+			return false;
+		}
+		nodeId = NodeId(id, (short)port);
+		return true;
+	}
+public:
+	MessageView(const char *data, int size);
+	bool isValid() { return valid; }
+	MsgTypes getType() { return msgType; }
+	NodeId getSender() { return sender; }
+	char getTtl() { return ttl; }
+	long getHeartbeat() { return heartbeat; }
+	bool nextDigestEntry(NodeId &entryId, long &entryHeartbeat);
+	bool readVersions(long &ack, long &base, long &version, int &numRequests);
+	bool readNodeId(NodeId &extraId);
+	bool nextSwimUpdate(NodeId &updateId, long &incarnation, SwimStates &state);
+};
+
+#endif /* _MESSAGE_H_ */
@@ -0,0 +1,634 @@
+/**********************************
+ * FILE NAME: MicroBench.cpp
+ *
+ * DESCRIPTION: Micro benchmark driver. Times the hot functions of the
+ * 				membership protocol, the emulated network and the log one at a
+ * 				time and prints their cost in ns/op and heap allocations/op
+ **********************************/
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Member.h"
+#include "EmulNet.h"
+#include "UdpNet.h"
+#include "Log.h"
+#include "MP1Node.h"
+#include <sys/stat.h>
+#include <malloc.h>
+#include <errno.h>
+#include <new>
+
+/*
+ * Macros
+ */
+// each benchmark repeats its rounds until at least this much time was spent
+#define MIN_BENCH_NS 200000000L
+// messages moved through the network per round of the network benchmarks
+#define MSGS_PER_ROUND 1000
+// address of the inbox that holds the messages making up the occupancy
+#define PARKED_ID 1000000
+
+/*
+ * Heap allocation counter. Every path into the heap, C++ or C, goes through
+ * these and on to glibc's own allocator
+ */
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t num, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+	void *__libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void *ptr);
+}
+
+static long allocCount = 0;
+
+extern "C" void *malloc(size_t size) {
+	allocCount++;
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t num, size_t size) {
+	allocCount++;
+	return __libc_calloc(num, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+	allocCount++;
+	return __libc_realloc(ptr, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) {
+	allocCount++;
+	*ptr = __libc_memalign(alignment, size);
+	return *ptr == NULL ? ENOMEM : 0;
+}
+
+extern "C" void free(void *ptr) {
+	__libc_free(ptr);
+}
+
+void *operator new(size_t size) {
+	allocCount++;
+	void *ptr = __libc_malloc(size ? size : 1);
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+	__libc_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	__libc_free(ptr);
+}
+
+/**
+ * FUNCTION NAME: nowNs
+ *
+ * DESCRIPTION: Monotonic clock in nanoseconds
+ */
+long nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/**
+ * FUNCTION NAME: runBench
+ *
+ * DESCRIPTION: Times round, which performs opsPerRound operations, until
+ * 				MIN_BENCH_NS have been spent in it and prints one result line.
+ * 				reset runs untimed after every round to put the state back
+ */
+void runBench(const char *name, long opsPerRound, const function<void()> &round, const function<void()> &reset = function<void()>()) {
+	long elapsed = 0;
+	long allocs = 0;
+	long ops = 0;
+
+	while (elapsed < MIN_BENCH_NS) {
+		long allocsBefore = allocCount;
+		long start = nowNs();
+		round();
+		elapsed += nowNs() - start;
+		allocs += allocCount - allocsBefore;
+		ops += opsPerRound;
+		if (reset) {
+			reset();
+		}
+	}
+
+	printf("%-44s %12ld %12.1f %10.3f\n", name, ops, (double)elapsed / ops, (double)allocs / ops);
+	fflush(stdout);
+}
+
+/**
+ * FUNCTION NAME: makeAddress
+ *
+ * DESCRIPTION: The address of node id, as ENinit hands them out
+ */
+Address makeAddress(int id) {
+	Address addr;
+	*(int *)(&addr.addr) = id;
+	*(short *)(&addr.addr[4]) = 0;
+	return addr;
+}
+
+/**
+ * FUNCTION NAME: setupParams
+ *
+ * DESCRIPTION: Writes a config for a quiet heartbeat group, with nothing
+ * 				dropped or forwarded and no bound on the network buffer, plus
+ * 				the extra lines, and loads it
+ */
+void setupParams(Params *par, const char *extra = "") {
+	char confPath[] = "bench.conf";
+	FILE *fp = fopen(confPath, "w");
+	if (fp == NULL) {
+		perror("bench.conf");
+		exit(1);
+	}
+	fprintf(fp, "MAX_NNB: 10\nSINGLE_FAILURE: 1\nDROP_MSG: 0\nMSG_DROP_PROB: 0\n");
+	fprintf(fp, "HEARTBEAT_DIGEST: 1\nEN_BUFFSIZE: 0\n%s", extra);
+	fclose(fp);
+	par->setparams(confPath);
+}
+
+/**
+ * FUNCTION NAME: benchSetMessage
+ *
+ * DESCRIPTION: Filling in the header of a heartbeat message
+ */
+void benchSetMessage() {
+	char buffer[WIRE_MAX_HEADER];
+	MessageHandler handler(buffer, sizeof(buffer));
+	NodeId nodeId = makeAddress(1).getNodeId();
+	long heartbeat = 0;
+
+	// heartbeats stay in the range a run of a few thousand ticks reaches
+	runBench("MessageHandler::setMessage", 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			handler.setMessage(nodeId, HEARTBEAT, heartbeat++ & 1023);
+		}
+	});
+}
+
+/**
+ * FUNCTION NAME: benchMembership
+ *
+ * DESCRIPTION: Heartbeat processing and the expiry check of a node that knows
+ * 				numMembers members, itself included. Heartbeats come from every
+ * 				member in turn, so lookups do not stay in one cache line
+ */
+void benchMembership(Params *par, EmulNet *en, Log *log, int numMembers) {
+	Member member;
+	Address addr;
+	en->ENinit(&addr, 0);
+	MP1Node node(&member, par, en, log, &addr);
+	node.initThisNode(&addr);
+
+	// peers get ids that no emulated node uses
+	int firstPeer = PARKED_ID + 1;
+	for (int i = 1; i < numMembers; i++) {
+		MemberListEntry entry(firstPeer + i, 0, 0, par->getcurrtime());
+		member.addMember(entry, TFAIL + 1);
+	}
+	int numPeers = numMembers - 1;
+	int stride = numPeers > 7919 ? 7919 : 1;
+	long heartbeat = 1;
+	int next = 0;
+	char name[64];
+
+	char buffer[WIRE_MAX_HEADER];
+	MessageHandler handler(buffer, sizeof(buffer));
+	vector<NodeId> peers(numPeers);
+	for (int i = 0; i < numPeers; i++) {
+		peers[i] = NodeId(firstPeer + 1 + (int)(((long)i * stride) % numPeers), 0);
+	}
+
+	sprintf(name, "MP1Node::recvCallBack/%d", numMembers);
+	runBench(name, 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			handler.setMessage(peers[next], HEARTBEAT, heartbeat++);
+			node.recvCallBack(NULL, (char *)handler.getMessage(), handler.getMessageSize());
+			next = next + 1 == numPeers ? 0 : next + 1;
+		}
+	});
+
+	sprintf(name, "MP1Node::updateMemberHeartbeat/fresh/%d", numMembers);
+	runBench(name, 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			node.updateMemberHeartbeat(peers[next], heartbeat++, 0);
+			next = next + 1 == numPeers ? 0 : next + 1;
+		}
+	});
+
+	sprintf(name, "MP1Node::updateMemberHeartbeat/stale/%d", numMembers);
+	runBench(name, 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			node.updateMemberHeartbeat(peers[next], 0, 0);
+			next = next + 1 == numPeers ? 0 : next + 1;
+		}
+	});
+
+	// no member expires and the node never gets to send its own heartbeat,
+	// so only the check for expiry timers that fired is left
+	sprintf(name, "MP1Node::nodeLoopOps/expiry/%d", numMembers);
+	runBench(name, 1, [&]() {
+		member.pingDeadline = INT_MAX;
+		node.nodeLoopOps();
+	});
+}
+
+/**
+ * FUNCTION NAME: benchMemory
+ *
+ * DESCRIPTION: Heap held by the membership state of a node that learned of
+ * 				numMembers members from their heartbeats, per member
+ */
+void benchMemory(Params *par, EmulNet *en, Log *log, int numMembers) {
+	Address addr;
+	en->ENinit(&addr, 0);
+	size_t before = mallinfo2().uordblks;
+	Member *member = new Member();
+	MP1Node *node = new MP1Node(member, par, en, log, &addr);
+	node->initThisNode(&addr);
+
+	int firstPeer = PARKED_ID + 1;
+	for (int i = 1; i < numMembers; i++) {
+		node->updateMemberHeartbeat(NodeId(firstPeer + i, 0), 1, 0);
+	}
+	size_t after = mallinfo2().uordblks;
+
+	char name[64];
+	sprintf(name, "Member memory/%d", numMembers);
+	printf("%-44s %12d %12.1f bytes/member\n", name, numMembers, (double)(after - before) / numMembers);
+	fflush(stdout);
+	delete node;
+	delete member;
+}
+
+/**
+ * FUNCTION NAME: benchScan
+ *
+ * DESCRIPTION: The scans of the membership table on their own: picking the
+ * 				entries fresh enough for a digest with every kernel of the
+ * 				structure of arrays, next to the same loop over an array of
+ * 				MemberListEntry, and finding entries by address through the
+ * 				table's index, next to an unordered_map
+ */
+void benchScan(int numMembers) {
+	unsigned int seed = 7;
+	int now = 1000;
+	MemberStore store;
+	vector<MemberListEntry> entries;
+	unordered_map<NodeId, size_t> index;
+	for (int i = 0; i < numMembers; i++) {
+		int timestamp = now - rand_r(&seed) % (2 * TREMOVE + 1);
+		store.push(NodeId(PARKED_ID + 1 + i, 0), i, timestamp);
+		entries.push_back(MemberListEntry(PARKED_ID + 1 + i, 0, i, timestamp));
+		index[NodeId(PARKED_ID + 1 + i, 0)] = i;
+	}
+	vector<int> selected;
+	selected.reserve(numMembers);
+	char name[64];
+
+	const char *kernelNames[] = { "scalar", "sse2", "avx2" };
+	for (int kernel = SCAN_SCALAR; kernel <= MemberStore::widestKernel(); kernel++) {
+		store.setKernel((scanKERNEL)kernel);
+		sprintf(name, "MemberStore::selectByAge/%s/%d", kernelNames[kernel], numMembers);
+		runBench(name, 1, [&]() {
+			selected.clear();
+			store.selectByAge(1, now, -1, TDIGEST, selected);
+		});
+	}
+
+	sprintf(name, "MemberListEntry age scan/%d", numMembers);
+	runBench(name, 1, [&]() {
+		selected.clear();
+		for (size_t pos = 1; pos < entries.size(); pos++) {
+			if (now - entries[pos].timestamp <= TDIGEST) {
+				selected.push_back(pos);
+			}
+		}
+	});
+
+	vector<NodeId> keys(1000);
+	for (size_t i = 0; i < keys.size(); i++) {
+		keys[i] = NodeId(PARKED_ID + 1 + rand_r(&seed) % numMembers, 0);
+	}
+	long found = 0;
+	sprintf(name, "MemberStore::find/%d", numMembers);
+	runBench(name, keys.size(), [&]() {
+		for (vector<NodeId>::iterator key = keys.begin(); key != keys.end(); ++key) {
+			found += store.find(*key);
+		}
+	});
+	sprintf(name, "unordered_map::find/%d", numMembers);
+	runBench(name, keys.size(), [&]() {
+		for (vector<NodeId>::iterator key = keys.begin(); key != keys.end(); ++key) {
+			found += index.find(*key)->second;
+		}
+	});
+	// keeps the lookups from being optimized away
+	if (found < 0) {
+		printf("%ld\n", found);
+	}
+}
+
+/**
+ * FUNCTION NAME: parkMessages
+ *
+ * DESCRIPTION: Brings the number of messages held by the network up to
+ * 				occupancy by sending them to an inbox nobody drains
+ */
+void parkMessages(EmulNet *en, Address *from, int occupancy) {
+	static int numParked = 0;
+	Address parked = makeAddress(PARKED_ID);
+	char data[32] = {0};
+	for (; numParked < occupancy; numParked++) {
+		en->ENsend(from, &parked, data, sizeof(data));
+	}
+	en->ENtick();
+}
+
+/**
+ * FUNCTION NAME: collectMessage
+ *
+ * DESCRIPTION: ENrecv callback that keeps the received buffers for release
+ */
+int collectMessage(void *env, char *buff, int size) {
+	((vector<char *> *)env)->push_back(buff);
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: benchNetwork
+ *
+ * DESCRIPTION: Sending, delivering and receiving heartbeat sized messages
+ * 				while occupancy other messages sit in the network. netName
+ * 				labels the results with the network's class
+ */
+void benchNetwork(EmulNet *en, const char *netName, Address *from, Address *to, int occupancy) {
+	char buffer[WIRE_MAX_HEADER];
+	MessageHandler handler(buffer, sizeof(buffer));
+	handler.setMessage(from->getNodeId(), HEARTBEAT, 1);
+	char *data = (char *)handler.getMessage();
+	int size = handler.getMessageSize();
+	vector<char *> received;
+	received.reserve(MSGS_PER_ROUND);
+	char name[64];
+
+	parkMessages(en, from, occupancy);
+
+	// empties the destination's inbox and hands its buffers back
+	auto drain = [&]() {
+		en->ENrecv(to, collectMessage, NULL, 1, &received);
+		for (vector<char *>::iterator it = received.begin(); it != received.end(); ++it) {
+			en->ENrelease(to, *it);
+		}
+		received.clear();
+	};
+
+	sprintf(name, "%s::ENsend/%d", netName, occupancy);
+	runBench(name, MSGS_PER_ROUND, [&]() {
+		for (int i = 0; i < MSGS_PER_ROUND; i++) {
+			en->ENsend(from, to, data, size);
+		}
+	}, [&]() {
+		en->ENtick();
+		drain();
+		en->ENtick();
+	});
+
+	sprintf(name, "%s::ENtick/deliver/%d", netName, occupancy);
+	for (int i = 0; i < MSGS_PER_ROUND; i++) {
+		en->ENsend(from, to, data, size);
+	}
+	runBench(name, MSGS_PER_ROUND, [&]() {
+		en->ENtick();
+	}, [&]() {
+		drain();
+		en->ENtick();
+		for (int i = 0; i < MSGS_PER_ROUND; i++) {
+			en->ENsend(from, to, data, size);
+		}
+	});
+	en->ENtick();
+	drain();
+	en->ENtick();
+
+	sprintf(name, "%s::ENrecv+ENrelease/%d", netName, occupancy);
+	for (int i = 0; i < MSGS_PER_ROUND; i++) {
+		en->ENsend(from, to, data, size);
+	}
+	en->ENtick();
+	runBench(name, MSGS_PER_ROUND, [&]() {
+		drain();
+	}, [&]() {
+		en->ENtick();
+		for (int i = 0; i < MSGS_PER_ROUND; i++) {
+			en->ENsend(from, to, data, size);
+		}
+		en->ENtick();
+	});
+	drain();
+	en->ENtick();
+}
+
+/**
+ * FUNCTION NAME: benchDelay
+ *
+ * DESCRIPTION: Delivering heartbeat sized messages over links with a
+ * 				LINK_DELAY of one time unit, from the tick that puts them in
+ * 				flight to the one that hands them to the inbox. Compare with
+ * 				ENtick/deliver/0, which does both in one tick
+ */
+void benchDelay() {
+	Params *par = new Params();
+	setupParams(par, "LINK_DELAY: 1\n");
+	EmulNet *en = new EmulNet(par);
+	Address from, to;
+	en->ENinit(&from, 0);
+	en->ENinit(&to, 0);
+
+	char buffer[WIRE_MAX_HEADER];
+	MessageHandler handler(buffer, sizeof(buffer));
+	handler.setMessage(from.getNodeId(), HEARTBEAT, 1);
+	char *data = (char *)handler.getMessage();
+	int size = handler.getMessageSize();
+	vector<char *> received;
+	received.reserve(MSGS_PER_ROUND);
+
+	// the copies in flight are due by the time, so it has to move on
+	for (int i = 0; i < MSGS_PER_ROUND; i++) {
+		en->ENsend(&from, &to, data, size);
+	}
+	runBench("EmulNet::ENtick/delayed/0", MSGS_PER_ROUND, [&]() {
+		en->ENtick();
+		par->globaltime++;
+		en->ENtick();
+	}, [&]() {
+		en->ENrecv(&to, collectMessage, NULL, 1, &received);
+		for (vector<char *>::iterator it = received.begin(); it != received.end(); ++it) {
+			en->ENrelease(&to, *it);
+		}
+		received.clear();
+		par->globaltime++;
+		en->ENtick();
+		par->globaltime++;
+		for (int i = 0; i < MSGS_PER_ROUND; i++) {
+			en->ENsend(&from, &to, data, size);
+		}
+	});
+
+	en->ENcleanup();
+	delete en;
+	delete par;
+}
+
+/**
+ * FUNCTION NAME: benchLog
+ *
+ * DESCRIPTION: Writing one line to dbg.log, and logging node additions as
+ * 				text and as dbg.bin event records
+ */
+void benchLog(Params *par, Log *log) {
+	NodeId nodeId = makeAddress(1).getNodeId();
+	runBench("Log::LOG", 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			log->LOG(nodeId, "Node %d.%d.%d.%d:%d joined at time %d", i & 0xff, 0, 0, 0, 0, i);
+		}
+	});
+
+	vector<NodeId> added(1000);
+	for (int i = 0; i < 1000; i++) {
+		added[i] = NodeId(i + 1, 0);
+	}
+	runBench("Log::logNodeAdd/text", 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			log->logNodeAdd(nodeId, added[i]);
+		}
+	});
+
+	Params binaryPar = *par;
+	binaryPar.LOG_FORMAT = BINARY_LOG;
+	Log binaryLog(&binaryPar);
+	runBench("Log::logNodeAdd/binary", 1000, [&]() {
+		for (int i = 0; i < 1000; i++) {
+			binaryLog.logNodeAdd(nodeId, added[i]);
+		}
+	});
+}
+
+/**
+ * FUNCTION NAME: usage
+ *
+ * DESCRIPTION: Prints the command line options
+ */
+void usage(const char *prog) {
+	printf("Usage: %s [-m sizes] [-o occupancies]\n", prog);
+	printf("  -m  comma separated membership sizes (default 10,1000,100000)\n");
+	printf("  -o  comma separated network occupancies (default 0,1000,100000)\n");
+}
+
+/**
+ * FUNCTION NAME: parseList
+ *
+ * DESCRIPTION: Parses a comma separated list of positive integers
+ */
+vector<int> parseList(const char *list) {
+	vector<int> values;
+	for (const char *c = list; *c; ) {
+		values.push_back(atoi(c));
+		c = strchr(c, ',');
+		if (c == NULL) {
+			break;
+		}
+		c++;
+	}
+	return values;
+}
+
+/**
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Runs every benchmark in a scratch directory, so the logs the
+ * 				benchmarked code writes do not overwrite those of Application
+ */
+int main(int argc, char *argv[]) {
+	vector<int> sizes = parseList("10,1000,100000");
+	vector<int> occupancies = parseList("0,1000,100000");
+
+	int opt;
+	while ((opt = getopt(argc, argv, "m:o:h")) != -1) {
+		switch (opt) {
+			case 'm':
+				sizes = parseList(optarg);
+				break;
+			case 'o':
+				occupancies = parseList(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	char workDir[] = "/tmp/microbench.XXXXXX";
+	if (mkdtemp(workDir) == NULL || chdir(workDir) != 0) {
+		perror("mkdtemp");
+		return 1;
+	}
+
+	Params *par = new Params();
+	setupParams(par);
+	EmulNet *en = new EmulNet(par);
+	Log *log = new Log(par);
+
+	Address from, to;
+	en->ENinit(&from, 0);
+	en->ENinit(&to, 0);
+
+	printf("%-44s %12s %12s %10s\n", "benchmark", "ops", "ns/op", "allocs/op");
+	benchSetMessage();
+	for (vector<int>::iterator size = sizes.begin(); size != sizes.end(); ++size) {
+		benchMembership(par, en, log, max(*size, 2));
+		benchMemory(par, en, log, max(*size, 2));
+		benchScan(max(*size, 2));
+	}
+	for (vector<int>::iterator occupancy = occupancies.begin(); occupancy != occupancies.end(); ++occupancy) {
+		benchNetwork(en, "EmulNet", &from, &to, *occupancy);
+	}
+	benchDelay();
+
+	// the same traffic through loopback sockets, where delivery is sendmmsg
+	// and receiving is recvmmsg
+	UdpNet *udp = new UdpNet(par);
+	Address udpFrom, udpTo;
+	udp->ENinit(&udpFrom, 0);
+	udp->ENinit(&udpTo, 0);
+	benchNetwork(udp, "UdpNet", &udpFrom, &udpTo, 0);
+	udp->ENcleanup();
+	delete udp;
+	benchLog(par, log);
+
+	en->ENcleanup();
+	delete log;
+	delete en;
+	delete par;
+
+	// nothing in the scratch directory is worth keeping
+	unlink("bench.conf");
+	unlink(DBG_LOG);
+	unlink(DBG_BIN);
+	unlink(STATS_LOG);
+	unlink("msgcount.log");
+	rmdir(workDir);
+	return 0;
+}
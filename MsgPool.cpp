@@ -0,0 +1,108 @@
+/**********************************
+ * FILE NAME: MsgPool.cpp
+ *
+ * DESCRIPTION: Definition of MsgPool class functions
+ **********************************/
+
+#include "MsgPool.h"
+
+/**
+ * Constructor
+ */
+MsgPool::MsgPool(): slabBytes(0), oversizeAllocs(0) {
+	for ( int i = 0; i < MSGPOOL_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ */
+MsgPool::~MsgPool() {
+	for ( vector<void *>::iterator it = slabs.begin(); it != slabs.end(); ++it ) {
+		free(*it);
+	}
+}
+
+/**
+ * FUNCTION NAME: acquire
+ *
+ * DESCRIPTION: Returns a buffer of at least size bytes from the smallest size
+ * 				class that fits it
+ */
+void *MsgPool::acquire(size_t size) {
+	int sizeClass = 0;
+	while ( sizeClass < MSGPOOL_CLASSES && ((size_t)1 << (MSGPOOL_MIN_SHIFT + sizeClass)) < size ) {
+		sizeClass++;
+	}
+
+	BufferHdr *hdr;
+	if ( sizeClass == MSGPOOL_CLASSES ) {
+		hdr = (BufferHdr *) malloc(sizeof(BufferHdr) + size);
+		oversizeAllocs++;
+	}
+	else {
+		if ( freeList[sizeClass] == NULL ) {
+			refill(sizeClass);
+		}
+		hdr = freeList[sizeClass];
+		freeList[sizeClass] = hdr->next;
+	}
+	hdr->sizeClass = sizeClass;
+	return hdr + 1;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Puts a buffer obtained from acquire back on its free list
+ */
+void MsgPool::release(void *buffer) {
+	BufferHdr *hdr = (BufferHdr *)buffer - 1;
+	int sizeClass = hdr->sizeClass;
+	if ( sizeClass == MSGPOOL_CLASSES ) {
+		free(hdr);
+		return;
+	}
+	hdr->next = freeList[sizeClass];
+	freeList[sizeClass] = hdr;
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Carves a new slab into buffers of the given size class and
+ * 				threads them onto its free list
+ */
+void MsgPool::refill(int sizeClass) {
+	size_t stride = sizeof(BufferHdr) + ((size_t)1 << (MSGPOOL_MIN_SHIFT + sizeClass));
+	size_t count = max((size_t)1, (size_t)MSGPOOL_SLAB_SIZE / stride);
+	char *slab = (char *) malloc(count * stride);
+	slabs.push_back(slab);
+	slabBytes += count * stride;
+
+	for ( size_t i = 0; i < count; i++ ) {
+		BufferHdr *hdr = (BufferHdr *)(slab + i * stride);
+		hdr->next = freeList[sizeClass];
+		freeList[sizeClass] = hdr;
+	}
+}
+
+/**
+ * FUNCTION NAME: getSlabBytes
+ *
+ * DESCRIPTION: Bytes taken from the heap for slabs so far
+ */
+long MsgPool::getSlabBytes() {
+	return slabBytes;
+}
+
+/**
+ * FUNCTION NAME: getOversizeAllocs
+ *
+ * DESCRIPTION: Number of buffers too large for any size class, each of which
+ * 				went to malloc
+ */
+long MsgPool::getOversizeAllocs() {
+	return oversizeAllocs;
+}
@@ -0,0 +1,55 @@
+/**********************************
+ * FILE NAME: MsgPool.h
+ *
+ * DESCRIPTION: Size-classed pool of message buffers
+ **********************************/
+
+#ifndef _MSGPOOL_H_
+#define _MSGPOOL_H_
+
+#include "stdincludes.h"
+
+// smallest size class is 1 << MSGPOOL_MIN_SHIFT bytes
+#define MSGPOOL_MIN_SHIFT 6
+// number of size classes, each twice the previous one (64 B .. 8 KB)
+#define MSGPOOL_CLASSES 8
+// bytes carved into buffers each time a size class runs dry
+#define MSGPOOL_SLAB_SIZE 65536
+
+/**
+ * CLASS NAME: MsgPool
+ *
+ * DESCRIPTION: Hands out buffers from per size class free lists. A class that
+ * 				runs dry is refilled with a whole slab, so once the pool has
+ * 				grown to the peak number of buffers in flight, acquire and
+ * 				release never touch the heap. Slabs are only returned to the
+ * 				heap when the pool is destroyed. Requests larger than the
+ * 				biggest class fall back to malloc.
+ */
+class MsgPool {
+private:
+	// every buffer is preceded by a header recording its size class
+	union BufferHdr {
+		int sizeClass;
+		// next free buffer while the buffer sits on a free list
+		BufferHdr *next;
+		// keep the payload as aligned as malloc would
+		max_align_t align;
+	};
+	BufferHdr *freeList[MSGPOOL_CLASSES];
+	vector<void *> slabs;
+	long slabBytes;
+	long oversizeAllocs;
+	void refill(int sizeClass);
+	MsgPool(const MsgPool &anotherPool);
+	MsgPool& operator = (const MsgPool &anotherPool);
+public:
+	MsgPool();
+	virtual ~MsgPool();
+	void *acquire(size_t size);
+	void release(void *buffer);
+	long getSlabBytes();
+	long getOversizeAllocs();
+};
+
+#endif /* _MSGPOOL_H_ */
@@ -0,0 +1,47 @@
+/**********************************
+ * FILE NAME: NodeId.h
+ *
+ * DESCRIPTION: Header file of NodeId class
+ **********************************/
+
+#ifndef _NODEID_H_
+#define _NODEID_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: NodeId
+ *
+ * DESCRIPTION: The id and port of a node packed into one 64-bit integer, the
+ * 				port in bits 32 to 47 and the id in the low 32 bits. It is
+ * 				trivially copyable, and copying, comparing, ordering and
+ * 				hashing one are single integer operations. The zero value, id
+ * 				0 and port 0, is no node
+ */
+class NodeId {
+public:
+	unsigned long long value;
+	NodeId(): value(0) {}
+	NodeId(int id, short port): value(((unsigned long long)(unsigned short)port << 32) | (unsigned int)id) {}
+	explicit NodeId(unsigned long long packed): value(packed) {}
+	int getid() const { return (int)(unsigned int)value; }
+	short getport() const { return (short)(value >> 32); }
+	bool isNull() const { return value == 0; }
+	bool operator ==(NodeId anotherId) const { return value == anotherId.value; }
+	bool operator !=(NodeId anotherId) const { return value != anotherId.value; }
+	bool operator <(NodeId anotherId) const { return value < anotherId.value; }
+	// id:port, as Address::getAddress prints it
+	string toString() const { return to_string(getid()) + ":" + to_string(getport()); }
+};
+
+/*
+ * Hash of a NodeId for the unordered containers. Ids are handed out densely,
+ * so the packed value itself spreads them over the buckets
+ */
+namespace std {
+	template<> struct hash<NodeId> {
+		size_t operator()(NodeId nodeId) const { return (size_t)nodeId.value; }
+	};
+}
+
+#endif /* _NODEID_H_ */
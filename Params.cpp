@@ -41,10 +41,219 @@ void Params::setparams(char *config_file) {
 	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
 	}
+
+	// defaults for the optional tunables
+	DISSEMINATION = FLOOD;
+	GOSSIP_FANOUT = 0;
+	GOSSIP_TTL = 0;
+	HEARTBEAT_DIGEST = 0;
+	HEARTBEAT_DELTA = 0;
+	DETECTOR = HEARTBEAT_DETECTOR;
+	SWIM_PERIOD = 6;
+	SWIM_TIMEOUT = 2;
+	SWIM_K = 3;
+	SWIM_SUSPECT = 0;
+	SWIM_PIGGYBACK = 16;
+	PHI_THRESHOLD = 8;
+	PHI_MIN_STDDEV = 2;
+	RUNNING_TIME = 0;
+	EN_BUFFSIZE = 30000;
+	EN_INBOXSIZE = 0;
+	SEED = 0;
+	THREADS = 1;
+	LOG_BUFFSIZE = 1 << 20;
+	LOG_FORMAT = TEXT_LOG;
+	TRANSPORT = EMULATED_TRANSPORT;
+	CLOCK = TICK_CLOCK;
+	TICK_MS = 100;
+	LINK_DELAY = 0;
+	LINK_JITTER = 0;
+	ZONES = 1;
+	ZONE_DELAY = -1;
+	ZONE_JITTER = -1;
+	SCENARIO = "";
+
+	// any further lines are optional tunables of the form "KEY: value"
+	char key[64];
+	char value[256];
+	while (fscanf(fp, " %63[^:]: %255s", key, value) == 2) {
+		setOptionalParam(key, value);
+	}
+
+	// by default a heartbeat is gossiped to ln of the group size plus two
+	// peers, enough for every node to hear it with high probability; with
+	// fewer, whole rounds miss some node and it is removed falsely
+	if (GOSSIP_FANOUT <= 0) {
+		GOSSIP_FANOUT = (int)ceil(log((double)EN_GPSZ)) + 2;
+	}
+
+	// by default a gossiped heartbeat lives long enough to reach the whole
+	// group with high probability, i.e. log base fanout of the group size
+	// plus one round of slack. It travels in a signed byte
+	if (GOSSIP_TTL <= 0) {
+		GOSSIP_TTL = min(127, (int)ceil(log((double)EN_GPSZ) / log((double)max(GOSSIP_FANOUT, 2))) + 1);
+	}
+
+	// deltas are digests sent to one peer at a time
+	if (HEARTBEAT_DELTA) {
+		HEARTBEAT_DIGEST = 1;
+	}
+
+	// with the wall clock nodes wait on their sockets, which only UDP has
+	if (CLOCK == WALL_CLOCK && TRANSPORT != UDP_TRANSPORT) {
+		printf("CLOCK: wall needs TRANSPORT: udp.\n");
+		exit(1);
+	}
+	// skipping time units only works while the network is simulated too
+	if (CLOCK == EVENT_CLOCK && TRANSPORT != EMULATED_TRANSPORT) {
+		printf("CLOCK: events needs TRANSPORT: emulated.\n");
+		exit(1);
+	}
+
+	// links between zones are as fast as the ones within a zone unless told
+	// otherwise
+	ZONES = min(ZONES, EN_GPSZ);
+	if (ZONE_DELAY < 0) {
+		ZONE_DELAY = LINK_DELAY;
+	}
+	if (ZONE_JITTER < 0) {
+		ZONE_JITTER = LINK_JITTER;
+	}
+	// real sockets have whatever latency the host gives them
+	if (max(LINK_DELAY + LINK_JITTER, ZONE_DELAY + ZONE_JITTER) > 0 && TRANSPORT != EMULATED_TRANSPORT) {
+		printf("LINK_DELAY and ZONE_DELAY need TRANSPORT: emulated.\n");
+		exit(1);
+	}
+
+	// cuts and restarts act on the emulated network's inboxes
+	if (!SCENARIO.empty() && TRANSPORT != EMULATED_TRANSPORT) {
+		printf("SCENARIO needs TRANSPORT: emulated.\n");
+		exit(1);
+	}
+
+	// a suspect needs about log(N) periods to hear of its suspicion and
+	// spread its refutation, so by default the timeout grows with the group
+	if (SWIM_SUSPECT <= 0) {
+		SWIM_SUSPECT = SWIM_PERIOD * max(3, (int)ceil(3 * log10((double)EN_GPSZ)));
+	}
+
 	fclose(fp);
 	return;
 }
 
+/**
+ * FUNCTION NAME: setOptionalParam
+ *
+ * DESCRIPTION: Set one of the optional tunables that may follow the required
+ * 				parameters in the config file
+ */
+void Params::setOptionalParam(char *key, char *value) {
+	if (strcmp(key, "DISSEMINATION") == 0) {
+		if (strcmp(value, "flood") == 0) {
+			DISSEMINATION = FLOOD;
+		} else if (strcmp(value, "gossip") == 0) {
+			DISSEMINATION = GOSSIP;
+		} else {
+			printf("Unknown dissemination mode '%s'.\n", value);
+			exit(1);
+		}
+	} else if (strcmp(key, "GOSSIP_FANOUT") == 0) {
+		GOSSIP_FANOUT = atoi(value);
+	} else if (strcmp(key, "GOSSIP_TTL") == 0) {
+		// the ttl travels in a signed byte
+		GOSSIP_TTL = max(1, min(127, atoi(value)));
+	} else if (strcmp(key, "HEARTBEAT_DIGEST") == 0) {
+		HEARTBEAT_DIGEST = atoi(value);
+	} else if (strcmp(key, "HEARTBEAT_DELTA") == 0) {
+		HEARTBEAT_DELTA = atoi(value);
+	} else if (strcmp(key, "DETECTOR") == 0) {
+		if (strcmp(value, "heartbeat") == 0) {
+			DETECTOR = HEARTBEAT_DETECTOR;
+		} else if (strcmp(value, "swim") == 0) {
+			DETECTOR = SWIM_DETECTOR;
+		} else if (strcmp(value, "phi") == 0) {
+			DETECTOR = PHI_DETECTOR;
+		} else {
+			printf("Unknown failure detector '%s'.\n", value);
+			exit(1);
+		}
+	} else if (strcmp(key, "SWIM_PERIOD") == 0) {
+		SWIM_PERIOD = atoi(value);
+	} else if (strcmp(key, "SWIM_TIMEOUT") == 0) {
+		SWIM_TIMEOUT = atoi(value);
+	} else if (strcmp(key, "SWIM_K") == 0) {
+		SWIM_K = atoi(value);
+	} else if (strcmp(key, "SWIM_SUSPECT") == 0) {
+		SWIM_SUSPECT = atoi(value);
+	} else if (strcmp(key, "SWIM_PIGGYBACK") == 0) {
+		SWIM_PIGGYBACK = atoi(value);
+	} else if (strcmp(key, "PHI_THRESHOLD") == 0) {
+		PHI_THRESHOLD = atof(value);
+	} else if (strcmp(key, "PHI_MIN_STDDEV") == 0) {
+		PHI_MIN_STDDEV = atof(value);
+	} else if (strcmp(key, "RUNNING_TIME") == 0) {
+		RUNNING_TIME = atoi(value);
+	} else if (strcmp(key, "STEP_RATE") == 0) {
+		STEP_RATE = atof(value);
+	} else if (strcmp(key, "EN_BUFFSIZE") == 0) {
+		EN_BUFFSIZE = atoi(value);
+	} else if (strcmp(key, "EN_INBOXSIZE") == 0) {
+		EN_INBOXSIZE = atoi(value);
+	} else if (strcmp(key, "SEED") == 0) {
+		SEED = atoi(value);
+	} else if (strcmp(key, "THREADS") == 0) {
+		THREADS = max(1, atoi(value));
+	} else if (strcmp(key, "LOG_BUFFSIZE") == 0) {
+		LOG_BUFFSIZE = max(0, atoi(value));
+	} else if (strcmp(key, "LOG_FORMAT") == 0) {
+		if (strcmp(value, "text") == 0) {
+			LOG_FORMAT = TEXT_LOG;
+		} else if (strcmp(value, "binary") == 0) {
+			LOG_FORMAT = BINARY_LOG;
+		} else {
+			printf("Unknown log format '%s'.\n", value);
+			exit(1);
+		}
+	} else if (strcmp(key, "TRANSPORT") == 0) {
+		if (strcmp(value, "emulated") == 0) {
+			TRANSPORT = EMULATED_TRANSPORT;
+		} else if (strcmp(value, "udp") == 0) {
+			TRANSPORT = UDP_TRANSPORT;
+		} else {
+			printf("Unknown transport '%s'.\n", value);
+			exit(1);
+		}
+	} else if (strcmp(key, "CLOCK") == 0) {
+		if (strcmp(value, "ticks") == 0) {
+			CLOCK = TICK_CLOCK;
+		} else if (strcmp(value, "wall") == 0) {
+			CLOCK = WALL_CLOCK;
+		} else if (strcmp(value, "events") == 0) {
+			CLOCK = EVENT_CLOCK;
+		} else {
+			printf("Unknown clock '%s'.\n", value);
+			exit(1);
+		}
+	} else if (strcmp(key, "TICK_MS") == 0) {
+		TICK_MS = max(1, atoi(value));
+	} else if (strcmp(key, "LINK_DELAY") == 0) {
+		LINK_DELAY = max(0, atoi(value));
+	} else if (strcmp(key, "LINK_JITTER") == 0) {
+		LINK_JITTER = max(0, atoi(value));
+	} else if (strcmp(key, "ZONES") == 0) {
+		ZONES = max(1, atoi(value));
+	} else if (strcmp(key, "ZONE_DELAY") == 0) {
+		ZONE_DELAY = max(0, atoi(value));
+	} else if (strcmp(key, "ZONE_JITTER") == 0) {
+		ZONE_JITTER = max(0, atoi(value));
+	} else if (strcmp(key, "SCENARIO") == 0) {
+		SCENARIO = value;
+	} else {
+		printf("Unknown parameter '%s' in config file.\n", key);
+		exit(1);
+	}
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
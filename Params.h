@@ -13,6 +13,21 @@
 
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
+// how heartbeats are spread through the group
+enum disseminationTYPE { FLOOD, GOSSIP };
+
+// how failed members are detected
+enum detectorTYPE { HEARTBEAT_DETECTOR, SWIM_DETECTOR, PHI_DETECTOR };
+
+// how the debug log is written
+enum logFormatTYPE { TEXT_LOG, BINARY_LOG };
+
+// what carries the messages between nodes
+enum transportTYPE { EMULATED_TRANSPORT, UDP_TRANSPORT };
+
+// what drives time: a loop over every tick or the monotonic clock
+enum clockTYPE { TICK_CLOCK, WALL_CLOCK, EVENT_CLOCK };
+
 /**
  * CLASS NAME: Params
  *
@@ -31,8 +46,39 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	// optional tunables, see setOptionalParam
+	disseminationTYPE DISSEMINATION;	// flood to every member or gossip to a random fanout
+	int GOSSIP_FANOUT;			// number of random peers each gossip round is sent to, 0 for ln(EN_GPSZ) + 2
+	int GOSSIP_TTL;				// rounds a gossiped heartbeat is forwarded before it dies, 1 to 127
+	int HEARTBEAT_DIGEST;		// piggyback the sender's membership table on its heartbeats
+	int HEARTBEAT_DELTA;		// digest only what each peer has not acknowledged yet
+	detectorTYPE DETECTOR;		// passive heartbeat timeouts, SWIM style probing or phi accrual
+	int SWIM_PERIOD;			// time units per SWIM protocol period
+	int SWIM_TIMEOUT;			// time units to wait for a direct ack before probing indirectly
+	int SWIM_K;					// number of members asked to probe indirectly
+	int SWIM_SUSPECT;			// time units a member stays suspect before it is declared failed
+	int SWIM_PIGGYBACK;			// maximum membership updates piggybacked on one SWIM message
+	double PHI_THRESHOLD;		// suspicion level above which a member is removed
+	double PHI_MIN_STDDEV;		// floor on the inter-arrival deviation, in time units
+	int RUNNING_TIME;			// time units to simulate, 0 keeps the default run length
+	int EN_BUFFSIZE;			// messages the network buffers in total, 0 for no limit
+	int EN_INBOXSIZE;			// messages buffered for any one node, 0 for no limit
+	int SEED;					// seed for every random choice, 0 seeds from the clock
+	int THREADS;				// threads that step the nodes each tick
+	int LOG_BUFFSIZE;			// bytes buffered in memory per log file, 0 writes every line through
+	logFormatTYPE LOG_FORMAT;	// text lines in dbg.log or fixed size event records in dbg.bin
+	transportTYPE TRANSPORT;	// in-memory emulated network or UDP sockets on 127.0.0.1
+	clockTYPE CLOCK;			// step every node every tick, wake nodes on input and deadlines, or jump between events
+	int TICK_MS;				// milliseconds per time unit with the wall clock
+	int LINK_DELAY;				// time units a message spends in flight beyond the tick it is sent in
+	int LINK_JITTER;			// extra time units in flight, drawn uniformly from 0 to this per copy
+	int ZONES;					// blocks of consecutive node ids that sit close to each other
+	int ZONE_DELAY;				// LINK_DELAY of the links between two zones
+	int ZONE_JITTER;			// LINK_JITTER of the links between two zones
+	string SCENARIO;			// file of timed crashes, recoveries, joins, cuts and drop rates, empty for the built-in failures
 	Params();
 	void setparams(char *);
+	void setOptionalParam(char *key, char *value);
 	int getcurrtime();
 };
 
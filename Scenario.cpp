@@ -0,0 +1,377 @@
+/**********************************
+ * FILE NAME: Scenario.cpp
+ *
+ * DESCRIPTION: Definition of Scenario class functions
+ **********************************/
+
+#include "Scenario.h"
+
+/**
+ * Constructor
+ *
+ * Reads the scenario file. Each line is a time, an action and its
+ * arguments, and # starts a comment:
+ *   100 crash 3,7-9          nodes by id, "all" or random:K
+ *   150 recover random:2
+ *   200 join 40-49           these nodes are held back until then
+ *   300 cut 1-25 26-50       no message crosses between the two sets
+ *   400 heal 1-25 26-50      "heal" alone undoes every cut
+ *   500 drop 0.1             MSG_DROP_PROB from now on, 0 stops dropping
+ * The time may be a repetition, first-last/period, such as 100-600/50
+ */
+Scenario::Scenario(Params *params, const char *path) {
+	par = params;
+	nextEvent = 0;
+	crashedAt.resize(par->EN_GPSZ + 1, -1);
+	detections.resize(par->EN_GPSZ + 1);
+	restartedFrom.resize(par->EN_GPSZ + 1, -1);
+	restartHeartbeat.resize(par->EN_GPSZ + 1, -1);
+	falseRemovals.resize(par->EN_GPSZ + 1, 0);
+	phaseStart = 0;
+	lastMessages = 0;
+	lastBytes = 0;
+	lastCutDrops = 0;
+
+	ifstream in(path);
+	if ( !in ) {
+		perror(path);
+		exit(1);
+	}
+	string text;
+	for ( int line = 1; getline(in, text); line++ ) {
+		text = text.substr(0, text.find('#'));
+		vector<char> buffer(text.begin(), text.end());
+		buffer.push_back('\0');
+		parseLine(&buffer[0], line);
+	}
+
+	// events at the same time apply in the order of the file
+	stable_sort(events.begin(), events.end(), [](const ScenarioEvent &a, const ScenarioEvent &b) {
+		return a.time < b.time;
+	});
+}
+
+/**
+ * FUNCTION NAME: parseLine
+ *
+ * DESCRIPTION: Adds the events of one line of the scenario file, one per
+ * 				time it repeats at
+ */
+void Scenario::parseLine(char *text, int line) {
+	vector<char *> words;
+	for ( char *word = strtok(text, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n") ) {
+		words.push_back(word);
+	}
+	if ( words.empty() ) {
+		return;
+	}
+
+	int first, last, period;
+	int fields = sscanf(words[0], "%d-%d/%d", &first, &last, &period);
+	if ( fields == 1 ) {
+		last = first;
+		period = 1;
+	} else if ( fields != 3 || period <= 0 || last < first ) {
+		printf("Line %d of the scenario: bad time '%s'.\n", line, words[0]);
+		exit(1);
+	}
+	if ( first < 0 || words.size() < 2 ) {
+		printf("Line %d of the scenario: expected a time and an action.\n", line);
+		exit(1);
+	}
+
+	ScenarioEvent event;
+	event.dropProb = 0;
+	size_t numArgs = 0;
+	if ( strcmp(words[1], "crash") == 0 ) {
+		event.action = CRASH_ACTION;
+		numArgs = 1;
+	} else if ( strcmp(words[1], "recover") == 0 ) {
+		event.action = RECOVER_ACTION;
+		numArgs = 1;
+	} else if ( strcmp(words[1], "join") == 0 ) {
+		event.action = JOIN_ACTION;
+		numArgs = 1;
+	} else if ( strcmp(words[1], "cut") == 0 ) {
+		event.action = CUT_ACTION;
+		numArgs = 2;
+	} else if ( strcmp(words[1], "heal") == 0 ) {
+		event.action = HEAL_ACTION;
+		numArgs = words.size() == 2 ? 0 : 2;
+	} else if ( strcmp(words[1], "drop") == 0 ) {
+		event.action = DROP_ACTION;
+		numArgs = 1;
+	} else {
+		printf("Line %d of the scenario: unknown action '%s'.\n", line, words[1]);
+		exit(1);
+	}
+	if ( words.size() != 2 + numArgs ) {
+		printf("Line %d of the scenario: '%s' takes %d arguments.\n", line, words[1], (int)numArgs);
+		exit(1);
+	}
+
+	if ( event.action == DROP_ACTION ) {
+		event.dropProb = atof(words[2]);
+		if ( event.dropProb < 0 || event.dropProb > 1 ) {
+			printf("Line %d of the scenario: drop probability '%s' is not between 0 and 1.\n", line, words[2]);
+			exit(1);
+		}
+	} else if ( numArgs > 0 ) {
+		event.nodes = parseNodes(words[2], line);
+		if ( numArgs > 1 ) {
+			event.others = parseNodes(words[3], line);
+		}
+		// which nodes are held back has to be known from the start, and
+		// cuts are healed by naming the same sets
+		if ( (event.action != CRASH_ACTION && event.action != RECOVER_ACTION) && (event.nodes.random > 0 || event.others.random > 0) ) {
+			printf("Line %d of the scenario: '%s' needs node ids, not random ones.\n", line, words[1]);
+			exit(1);
+		}
+	}
+
+	for ( int time = first; time <= last; time += period ) {
+		event.time = time;
+		events.push_back(event);
+	}
+}
+
+/**
+ * FUNCTION NAME: parseNodes
+ *
+ * DESCRIPTION: Parses a set of nodes: "all", random:K, or comma separated
+ * 				ids and first-last ranges of ids
+ */
+ScenarioNodes Scenario::parseNodes(const char *text, int line) {
+	ScenarioNodes nodes;
+	if ( strcmp(text, "all") == 0 ) {
+		for ( int id = 1; id <= par->EN_GPSZ; id++ ) {
+			nodes.ids.push_back(id);
+		}
+		return nodes;
+	}
+	if ( sscanf(text, "random:%d", &nodes.random) == 1 ) {
+		if ( nodes.random <= 0 ) {
+			printf("Line %d of the scenario: bad node count in '%s'.\n", line, text);
+			exit(1);
+		}
+		return nodes;
+	}
+
+	for ( const char *c = text; *c; ) {
+		int first, last, length;
+		if ( sscanf(c, "%d-%d%n", &first, &last, &length) != 2 ) {
+			if ( sscanf(c, "%d%n", &first, &length) != 1 ) {
+				printf("Line %d of the scenario: bad nodes '%s'.\n", line, text);
+				exit(1);
+			}
+			last = first;
+		}
+		if ( first < 1 || last > par->EN_GPSZ || last < first ) {
+			printf("Line %d of the scenario: node ids go from 1 to %d.\n", line, par->EN_GPSZ);
+			exit(1);
+		}
+		for ( int id = first; id <= last; id++ ) {
+			nodes.ids.push_back(id);
+		}
+		c += length;
+		if ( *c == ',' ) {
+			c++;
+		} else if ( *c ) {
+			printf("Line %d of the scenario: bad nodes '%s'.\n", line, text);
+			exit(1);
+		}
+	}
+	return nodes;
+}
+
+/**
+ * FUNCTION NAME: nextTime
+ *
+ * DESCRIPTION: Time of the next event not applied yet, INT_MAX after the
+ * 				last one
+ */
+int Scenario::nextTime() {
+	return nextEvent < events.size() ? events[nextEvent].time : INT_MAX;
+}
+
+/**
+ * FUNCTION NAME: takeDue
+ *
+ * DESCRIPTION: Hands out the next event due at or before now, if any
+ */
+bool Scenario::takeDue(int now, ScenarioEvent &event) {
+	if ( nextEvent >= events.size() || events[nextEvent].time > now ) {
+		return false;
+	}
+	event = events[nextEvent++];
+	return true;
+}
+
+/**
+ * FUNCTION NAME: heldBack
+ *
+ * DESCRIPTION: Ids of the nodes that join, which are not introduced at the
+ * 				start but when their join comes up
+ */
+vector<int> Scenario::heldBack() {
+	vector<int> ids;
+	for ( vector<ScenarioEvent>::iterator event = events.begin(); event != events.end(); ++event ) {
+		if ( event->action == JOIN_ACTION ) {
+			ids.insert(ids.end(), event->nodes.ids.begin(), event->nodes.ids.end());
+		}
+	}
+	return ids;
+}
+
+/**
+ * FUNCTION NAME: noteCrash
+ *
+ * DESCRIPTION: Records that the nodes with the given ids crashed now, with up
+ * 				nodes left to detect it
+ */
+void Scenario::noteCrash(int now, const vector<int> &ids, int up) {
+	for ( vector<int>::const_iterator id = ids.begin(); id != ids.end(); ++id ) {
+		crashedAt[*id] = now;
+	}
+	if ( crashes.empty() || crashes.back().time != now ) {
+		ScenarioCrash crash;
+		crash.time = now;
+		crash.crashed = 0;
+		crashes.push_back(crash);
+	}
+	crashes.back().crashed += ids.size();
+	crashes.back().expected = (long)crashes.back().crashed * up;
+}
+
+/**
+ * FUNCTION NAME: noteRestart
+ *
+ * DESCRIPTION: Records that the crashed node with the given id restarted
+ * 				now, sending heartbeats from the given one on
+ */
+void Scenario::noteRestart(int id, long heartbeat) {
+	restartedFrom[id] = crashedAt[id];
+	restartHeartbeat[id] = heartbeat;
+	crashedAt[id] = -1;
+}
+
+/**
+ * FUNCTION NAME: noteRemoval
+ *
+ * DESCRIPTION: Records that observer removed a node, last having heard the
+ * 				given heartbeat from it. That is a detection when the node is
+ * 				down, and also when it restarted but the observer had not heard
+ * 				from it since. Otherwise the node was falsely removed. Only
+ * 				touches the observer's own records, so nodes stepped on
+ * 				different threads can call it at once
+ */
+void Scenario::noteRemoval(NodeId observer, NodeId removed, long heartbeat) {
+	int observerId = observer.getid();
+	int removedId = removed.getid();
+	if ( observerId < 1 || observerId > par->EN_GPSZ || removedId < 1 || removedId > par->EN_GPSZ ) {
+		return;
+	}
+	int crashTime = crashedAt[removedId];
+	if ( crashTime < 0 && restartHeartbeat[removedId] >= 0 && heartbeat < restartHeartbeat[removedId] ) {
+		crashTime = restartedFrom[removedId];
+	}
+	if ( crashTime < 0 ) {
+		falseRemovals[observerId]++;
+		return;
+	}
+	ScenarioDetection detection;
+	detection.removed = removedId;
+	detection.crashTime = crashTime;
+	detection.latency = par->getcurrtime() - crashTime;
+	detections[observerId].push_back(detection);
+}
+
+/**
+ * FUNCTION NAME: closePhase
+ *
+ * DESCRIPTION: Ends the phase that runs up to and including now, given the
+ * 				group's running totals and the number of nodes up
+ */
+void Scenario::closePhase(int now, int up, long messages, long bytes, long cutDrops) {
+	if ( now < phaseStart ) {
+		return;
+	}
+	ScenarioPhase phase;
+	phase.start = phaseStart;
+	phase.end = now;
+	phase.up = up;
+	phase.messages = messages - lastMessages;
+	phase.bytes = bytes - lastBytes;
+	phase.cutDrops = cutDrops - lastCutDrops;
+	phases.push_back(phase);
+	phaseStart = now + 1;
+	lastMessages = messages;
+	lastBytes = bytes;
+	lastCutDrops = cutDrops;
+}
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: Nearest rank percentile of sorted values, -1 when empty
+ */
+static int percentile(const vector<int> &sorted, double q) {
+	if ( sorted.empty() ) {
+		return -1;
+	}
+	size_t rank = (size_t)ceil(q * sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * FUNCTION NAME: report
+ *
+ * DESCRIPTION: Writes what was sent in each phase and, for the nodes crashed
+ * 				at each time, how many of the expected removals happened and
+ * 				how long they took. Only the first removal of a crashed node
+ * 				by each observer counts
+ */
+void Scenario::report(const char *path) {
+	FILE *fp = fopen(path, "w");
+	if ( fp == NULL ) {
+		perror(path);
+		exit(1);
+	}
+
+	for ( vector<ScenarioPhase>::iterator phase = phases.begin(); phase != phases.end(); ++phase ) {
+		fprintf(fp, "phase %6d-%-6d up %5d sent %9ld bytes %11ld per_tick %10.1f dropped_cut %ld\n",
+				phase->start, phase->end, phase->up, phase->messages, phase->bytes,
+				(double)phase->messages / (phase->end - phase->start + 1), phase->cutDrops);
+	}
+
+	// latencies by crash time, the first removal per observer and crash
+	map<int, vector<int> > latencies;
+	for ( size_t observer = 0; observer < detections.size(); observer++ ) {
+		// recorded in time order, which a stable sort keeps within each crash
+		vector<ScenarioDetection> &found = detections[observer];
+		stable_sort(found.begin(), found.end(), [](const ScenarioDetection &a, const ScenarioDetection &b) {
+			return a.removed != b.removed ? a.removed < b.removed : a.crashTime < b.crashTime;
+		});
+		for ( size_t i = 0; i < found.size(); i++ ) {
+			if ( i == 0 || found[i].removed != found[i - 1].removed || found[i].crashTime != found[i - 1].crashTime ) {
+				latencies[found[i].crashTime].push_back(found[i].latency);
+			}
+		}
+	}
+
+	long detected = 0, expected = 0, falsePositives = 0;
+	for ( vector<ScenarioCrash>::iterator crash = crashes.begin(); crash != crashes.end(); ++crash ) {
+		vector<int> &sorted = latencies[crash->time];
+		sort(sorted.begin(), sorted.end());
+		fprintf(fp, "crash %6d nodes %5d detected %8ld of %8ld p50 %d p90 %d p99 %d max %d\n",
+				crash->time, crash->crashed, (long)sorted.size(), crash->expected,
+				percentile(sorted, 0.5), percentile(sorted, 0.9), percentile(sorted, 0.99), percentile(sorted, 1.0));
+		detected += sorted.size();
+		expected += crash->expected;
+	}
+	for ( size_t id = 0; id < falseRemovals.size(); id++ ) {
+		falsePositives += falseRemovals[id];
+	}
+	fprintf(fp, "group detected %ld of %ld false_removals %ld\n", detected, expected, falsePositives);
+	fclose(fp);
+}
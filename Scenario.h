@@ -0,0 +1,132 @@
+/**********************************
+ * FILE NAME: Scenario.h
+ *
+ * DESCRIPTION: Header file of Scenario class
+ **********************************/
+
+#ifndef _SCENARIO_H_
+#define _SCENARIO_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "NodeId.h"
+
+/*
+ * Macros
+ */
+#define SCENARIO_LOG "scenario.log"
+
+// what a scenario event does
+enum scenarioACTION { CRASH_ACTION, RECOVER_ACTION, JOIN_ACTION, CUT_ACTION, HEAL_ACTION, DROP_ACTION };
+
+/**
+ * STRUCT NAME: ScenarioNodes
+ *
+ * DESCRIPTION: The nodes an event applies to: the ids listed, or random
+ * 				nodes picked when the event is applied among those it can
+ * 				apply to
+ */
+struct ScenarioNodes {
+	vector<int> ids;
+	int random;
+	ScenarioNodes(): random(0) {}
+};
+
+/**
+ * STRUCT NAME: ScenarioEvent
+ *
+ * DESCRIPTION: One line of a scenario file, at one time
+ */
+struct ScenarioEvent {
+	int time;
+	scenarioACTION action;
+	ScenarioNodes nodes;
+	// the other side of a cut or heal
+	ScenarioNodes others;
+	double dropProb;
+};
+
+/**
+ * STRUCT NAME: ScenarioPhase
+ *
+ * DESCRIPTION: What the group sent between two consecutive event times
+ */
+struct ScenarioPhase {
+	int start;
+	int end;
+	int up;
+	long messages;
+	long bytes;
+	long cutDrops;
+};
+
+/**
+ * STRUCT NAME: ScenarioDetection
+ *
+ * DESCRIPTION: One node's removal of a crashed node
+ */
+struct ScenarioDetection {
+	int removed;
+	int crashTime;
+	int latency;
+};
+
+/**
+ * STRUCT NAME: ScenarioCrash
+ *
+ * DESCRIPTION: The nodes crashed at one time, and how many removals of them
+ * 				are expected: one by every other node up at that time
+ */
+struct ScenarioCrash {
+	int time;
+	int crashed;
+	long expected;
+};
+
+/**
+ * CLASS NAME: Scenario
+ *
+ * DESCRIPTION: Timed crashes, recoveries, joins, link cuts and drop rate
+ * 				changes read from the file named by SCENARIO, in place of the
+ * 				failures fail() has built in. Application applies the events
+ * 				that are due and tells it what happened. It reports what the
+ * 				group sent between events and how long the other nodes took
+ * 				to remove each crashed node to SCENARIO_LOG
+ */
+class Scenario {
+private:
+	Params *par;
+	// sorted by time, lines with the same time in file order
+	vector<ScenarioEvent> events;
+	size_t nextEvent;
+	// time each node id crashed at, -1 while it is up
+	vector<int> crashedAt;
+	// for each node id restarted from a crash, the time of that crash and
+	// the first heartbeat of the restarted node, -1 if it never was
+	vector<int> restartedFrom;
+	vector<long> restartHeartbeat;
+	// by observer id: the crashed node it removed, the crash time and the
+	// time units it took, and its removals of nodes that were up
+	vector<vector<ScenarioDetection> > detections;
+	vector<long> falseRemovals;
+	vector<ScenarioPhase> phases;
+	vector<ScenarioCrash> crashes;
+	int phaseStart;
+	long lastMessages;
+	long lastBytes;
+	long lastCutDrops;
+	void parseLine(char *text, int line);
+	ScenarioNodes parseNodes(const char *text, int line);
+public:
+	Scenario(Params *params, const char *path);
+	int nextTime();
+	bool takeDue(int now, ScenarioEvent &event);
+	vector<int> heldBack();
+	void noteCrash(int now, const vector<int> &ids, int up);
+	void noteRestart(int id, long heartbeat);
+	void noteRemoval(NodeId observer, NodeId removed, long heartbeat);
+	void closePhase(int now, int up, long messages, long bytes, long cutDrops);
+	void report(const char *path);
+};
+
+#endif /* _SCENARIO_H_ */
@@ -0,0 +1,91 @@
+/**********************************
+ * FILE NAME: ThreadPool.cpp
+ *
+ * DESCRIPTION: Definition of ThreadPool class functions
+ **********************************/
+
+#include "ThreadPool.h"
+
+/**
+ * Constructor
+ */
+ThreadPool::ThreadPool(int numThreads): numTasks(0), nextTask(0), busy(0), batch(0), stopping(false) {
+	for ( int i = 1; i < numThreads; i++ ) {
+		workers.push_back(thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+/**
+ * Destructor
+ */
+ThreadPool::~ThreadPool() {
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for ( vector<thread>::iterator it = workers.begin(); it != workers.end(); ++it ) {
+		it->join();
+	}
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Calls task(0) .. task(numTasks - 1) spread over the pool and
+ * 				waits for all of them
+ */
+void ThreadPool::run(int numTasks, const function<void(int)> &task) {
+	{
+		unique_lock<mutex> guard(lock);
+		this->task = task;
+		this->numTasks = numTasks;
+		nextTask = 0;
+		busy = workers.size();
+		batch++;
+	}
+	wake.notify_all();
+
+	runTasks();
+
+	unique_lock<mutex> guard(lock);
+	finished.wait(guard, [this] { return busy == 0; });
+}
+
+/**
+ * FUNCTION NAME: runTasks
+ *
+ * DESCRIPTION: Takes tasks of the current batch until none are left
+ */
+void ThreadPool::runTasks() {
+	int next;
+	while ( (next = nextTask++) < numTasks ) {
+		task(next);
+	}
+}
+
+/**
+ * FUNCTION NAME: workerLoop
+ *
+ * DESCRIPTION: Body of a worker thread, sleeps until a new batch arrives
+ */
+void ThreadPool::workerLoop() {
+	long seen = 0;
+	while ( true ) {
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [this, seen] { return stopping || batch != seen; });
+			if ( stopping ) {
+				return;
+			}
+			seen = batch;
+		}
+
+		runTasks();
+
+		unique_lock<mutex> guard(lock);
+		if ( --busy == 0 ) {
+			finished.notify_one();
+		}
+	}
+}
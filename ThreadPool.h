@@ -0,0 +1,45 @@
+/**********************************
+ * FILE NAME: ThreadPool.h
+ *
+ * DESCRIPTION: Fixed pool of worker threads for the parallel tick engine
+ **********************************/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: ThreadPool
+ *
+ * DESCRIPTION: Runs batches of independent tasks on a fixed set of threads.
+ * 				The calling thread takes part in every batch, so a pool of n
+ * 				threads starts n - 1 workers. Tasks are handed out one at a
+ * 				time as threads become free, and run returns once the whole
+ * 				batch is done
+ */
+class ThreadPool {
+private:
+	vector<thread> workers;
+	mutex lock;
+	condition_variable wake;
+	condition_variable finished;
+	function<void(int)> task;
+	int numTasks;
+	atomic<int> nextTask;
+	// workers still busy with the current batch
+	int busy;
+	// bumped for every batch so sleeping workers can tell it is new
+	long batch;
+	bool stopping;
+	void workerLoop();
+	void runTasks();
+	ThreadPool(const ThreadPool &anotherPool);
+	ThreadPool& operator = (const ThreadPool &anotherPool);
+public:
+	ThreadPool(int numThreads);
+	virtual ~ThreadPool();
+	void run(int numTasks, const function<void(int)> &task);
+};
+
+#endif /* _THREADPOOL_H_ */
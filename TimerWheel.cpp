@@ -0,0 +1,219 @@
+/**********************************
+ * FILE NAME: TimerWheel.cpp
+ *
+ * DESCRIPTION: Definition of TimerWheel class functions
+ **********************************/
+
+#include "TimerWheel.h"
+
+/**
+ * Constructor
+ */
+TimerWheel::TimerWheel(long now): freeList(-1), current(now), numArmed(0) {
+	for ( int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++ ) {
+		heads[i] = -1;
+	}
+	memset(occupied, 0, sizeof(occupied));
+}
+
+/**
+ * FUNCTION NAME: arm
+ *
+ * DESCRIPTION: Starts a timer that fires with key once the time reaches
+ * 				deadline, and returns its handle. A deadline that has already
+ * 				passed fires on the next advance
+ */
+int TimerWheel::arm(long deadline, long long key) {
+	int handle;
+	if ( freeList >= 0 ) {
+		handle = freeList;
+		freeList = timers[handle].next;
+	} else {
+		handle = timers.size();
+		timers.push_back(TimerNode());
+	}
+	timers[handle].deadline = deadline;
+	timers[handle].key = key;
+	link(handle, current + 1);
+	numArmed++;
+	return handle;
+}
+
+/**
+ * FUNCTION NAME: rearm
+ *
+ * DESCRIPTION: Moves an armed timer to a new deadline
+ */
+void TimerWheel::rearm(int handle, long deadline) {
+	unlink(handle);
+	timers[handle].deadline = deadline;
+	link(handle, current + 1);
+}
+
+/**
+ * FUNCTION NAME: cancel
+ *
+ * DESCRIPTION: Stops an armed timer and frees its handle
+ */
+void TimerWheel::cancel(int handle) {
+	unlink(handle);
+	timers[handle].slot = -1;
+	timers[handle].next = freeList;
+	freeList = handle;
+	numArmed--;
+}
+
+/**
+ * FUNCTION NAME: link
+ *
+ * DESCRIPTION: Puts a timer into the slot its deadline belongs in. Deadlines
+ * 				before earliest, the first time whose slot has not been looked
+ * 				at yet, are treated as due then
+ */
+void TimerWheel::link(int handle, long earliest) {
+	TimerNode &timer = timers[handle];
+	long deadline = max(timer.deadline, earliest);
+	long differing = deadline ^ current;
+	int level = 0;
+	while ( level < WHEEL_LEVELS - 1 && (differing >> (WHEEL_BITS * (level + 1))) != 0 ) {
+		level++;
+	}
+	int slot = (deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+	// beyond the range of the top level: park it in the top level slot that
+	// is looked at each time the time wraps around the whole wheel, where it
+	// is placed again
+	if ( (differing >> (WHEEL_BITS * WHEEL_LEVELS)) != 0 ) {
+		slot = 0;
+	}
+
+	timer.slot = level * WHEEL_SLOTS + slot;
+	timer.prev = -1;
+	timer.next = heads[timer.slot];
+	if ( timer.next >= 0 ) {
+		timers[timer.next].prev = handle;
+	}
+	heads[timer.slot] = handle;
+	occupied[level] |= 1UL << slot;
+}
+
+/**
+ * FUNCTION NAME: unlink
+ *
+ * DESCRIPTION: Takes a timer out of its slot
+ */
+void TimerWheel::unlink(int handle) {
+	TimerNode &timer = timers[handle];
+	if ( timer.prev >= 0 ) {
+		timers[timer.prev].next = timer.next;
+	} else {
+		heads[timer.slot] = timer.next;
+		if ( timer.next < 0 ) {
+			occupied[timer.slot / WHEEL_SLOTS] &= ~(1UL << (timer.slot % WHEEL_SLOTS));
+		}
+	}
+	if ( timer.next >= 0 ) {
+		timers[timer.next].prev = timer.prev;
+	}
+}
+
+/**
+ * FUNCTION NAME: cascade
+ *
+ * DESCRIPTION: Places again every timer of the level's slot the current time
+ * 				just entered, which moves them to lower levels
+ */
+void TimerWheel::cascade(int level) {
+	int slot = level * WHEEL_SLOTS + ((current >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+	int handle = heads[slot];
+	heads[slot] = -1;
+	occupied[level] &= ~(1UL << (slot % WHEEL_SLOTS));
+	while ( handle >= 0 ) {
+		int next = timers[handle].next;
+		// the slot of the current time is still to be looked at
+		link(handle, current);
+		handle = next;
+	}
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Moves the current time up to now, one time unit at a time,
+ * 				and appends the keys of the timers that fire to expired.
+ * 				Fired timers are freed, in the order they fire
+ */
+void TimerWheel::advance(long now, vector<long long> &expired) {
+	while ( current < now ) {
+		// nothing is armed, so nothing can fire or move down on the way
+		if ( numArmed == 0 ) {
+			current = now;
+			return;
+		}
+		current++;
+		int level = 1;
+		while ( level < WHEEL_LEVELS && (current & ((1L << (WHEEL_BITS * level)) - 1)) == 0 ) {
+			level++;
+		}
+		for ( level--; level > 0; level-- ) {
+			cascade(level);
+		}
+
+		int slot = current & (WHEEL_SLOTS - 1);
+		int handle = heads[slot];
+		heads[slot] = -1;
+		occupied[0] &= ~(1UL << slot);
+		while ( handle >= 0 ) {
+			int next = timers[handle].next;
+			if ( timers[handle].deadline <= current ) {
+				expired.push_back(timers[handle].key);
+				timers[handle].slot = -1;
+				timers[handle].next = freeList;
+				freeList = handle;
+				numArmed--;
+			} else {
+				link(handle, current + 1);
+			}
+			handle = next;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: nextDeadline
+ *
+ * DESCRIPTION: A time no later than the earliest deadline of an armed timer,
+ * 				exact when that timer sits in level 0. LONG_MAX when no timer
+ * 				is armed
+ */
+long TimerWheel::nextDeadline() {
+	for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+		if ( occupied[level] == 0 ) {
+			continue;
+		}
+		// the slots of a level are looked at in order starting after the one
+		// of the current time, so rotate that one to the top bit
+		int shift = WHEEL_BITS * level;
+		int start = (((current >> shift) & (WHEEL_SLOTS - 1)) + 1) & (WHEEL_SLOTS - 1);
+		unsigned long bits = occupied[level];
+		unsigned long rotated = start == 0 ? bits : (bits >> start) | (bits << (WHEEL_SLOTS - start));
+		int distance = __builtin_ctzl(rotated) + 1;
+		long slotStart = ((current >> shift) + distance) << shift;
+		return level == 0 ? slotStart : max(slotStart, current + 1);
+	}
+	return LONG_MAX;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Cancels every timer, the current time is kept
+ */
+void TimerWheel::clear() {
+	timers.clear();
+	freeList = -1;
+	numArmed = 0;
+	for ( int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++ ) {
+		heads[i] = -1;
+	}
+	memset(occupied, 0, sizeof(occupied));
+}
@@ -0,0 +1,67 @@
+/**********************************
+ * FILE NAME: TimerWheel.h
+ *
+ * DESCRIPTION: Header file of TimerWheel class
+ **********************************/
+
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// bits of the time each level of the wheel resolves, and its number of slots
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+// levels of the wheel, deadlines further out than WHEEL_SLOTS^WHEEL_LEVELS
+// time units are parked in the top level until they come into range
+#define WHEEL_LEVELS 4
+
+/**
+ * CLASS NAME: TimerWheel
+ *
+ * DESCRIPTION: Hierarchical timing wheel. Each timer carries a key and fires
+ * 				once the time passed to advance reaches its deadline. Level 0
+ * 				has one slot per time unit, and each level above has slots
+ * 				WHEEL_SLOTS times as long. A timer sits at the level of the
+ * 				highest digit in which its deadline differs from the current
+ * 				time, and moves down a level whenever the current time enters
+ * 				its slot. Arming, re-arming and cancelling are O(1), and
+ * 				advancing by one time unit only touches the timers that fire
+ * 				or move down
+ */
+class TimerWheel {
+private:
+	// timers live in one vector and are linked into their slot by index
+	struct TimerNode {
+		long deadline;
+		long long key;
+		int prev;
+		int next;
+		// level * WHEEL_SLOTS + slot, or -1 while the timer is free
+		int slot;
+	};
+	vector<TimerNode> timers;
+	int freeList;
+	int heads[WHEEL_LEVELS * WHEEL_SLOTS];
+	// one bit per non-empty slot, per level
+	unsigned long occupied[WHEEL_LEVELS];
+	long current;
+	size_t numArmed;
+	void link(int handle, long earliest);
+	void unlink(int handle);
+	void cascade(int level);
+public:
+	TimerWheel(long now = 0);
+	int arm(long deadline, long long key);
+	void rearm(int handle, long deadline);
+	void cancel(int handle);
+	void advance(long now, vector<long long> &expired);
+	long nextDeadline();
+	void clear();
+	size_t size() { return numArmed; }
+};
+
+#endif /* _TIMERWHEEL_H_ */
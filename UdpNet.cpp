@@ -0,0 +1,316 @@
+/**********************************
+ * FILE NAME: UdpNet.cpp
+ *
+ * DESCRIPTION: Definition of UdpNet class functions
+ **********************************/
+
+#include "UdpNet.h"
+#include <errno.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+
+/**
+ * Struct Name: udp_batch
+ *
+ * DESCRIPTION: Landing space for one recvmmsg call. Nodes may receive on
+ * 				several threads at once, so every thread has its own
+ */
+struct udp_batch {
+	vector<char> buffers;
+	int slotSize;
+	struct mmsghdr msgs[UDP_BATCH];
+	struct iovec iov[UDP_BATCH];
+	char control[UDP_BATCH][CMSG_SPACE(sizeof(unsigned int))];
+
+	udp_batch(): slotSize(0) {}
+
+	// points every message at its slot, and gives back the full control space
+	// recvmmsg shrank to what it used
+	void prepare(int size) {
+		if (size != slotSize) {
+			slotSize = size;
+			buffers.resize((size_t)UDP_BATCH * size);
+		}
+		memset(msgs, 0, sizeof(msgs));
+		for ( int i = 0; i < UDP_BATCH; i++ ) {
+			iov[i].iov_base = &buffers[(size_t)i * slotSize];
+			iov[i].iov_len = slotSize;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = control[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+		}
+	}
+};
+
+/**
+ * Constructor
+ */
+UdpNet::UdpNet(Params *p): EmulNet(p) {
+	UDPraiseFileLimit();
+	// ids start at 1
+	nodes.resize(1);
+	nodes[0].fd = -1;
+}
+
+/**
+ * Destructor
+ */
+UdpNet::~UdpNet() {
+	for ( vector<udp_node>::iterator node = nodes.begin(); node != nodes.end(); ++node ) {
+		if ( node->fd >= 0 ) {
+			close(node->fd);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: UDPraiseFileLimit
+ *
+ * DESCRIPTION: Every node holds a socket, so the soft limit on open files is
+ * 				raised to fit the group, up to the hard limit
+ */
+void UdpNet::UDPraiseFileLimit() {
+	struct rlimit limit;
+	rlim_t needed = (rlim_t)par->EN_GPSZ + UDP_SPARE_FDS;
+
+	if ( getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur >= needed ) {
+		return;
+	}
+	if ( limit.rlim_max != RLIM_INFINITY && limit.rlim_max < needed ) {
+		printf("%d nodes need %ld open files, the hard limit is %ld.\n", par->EN_GPSZ, (long)needed, (long)limit.rlim_max);
+		exit(1);
+	}
+	limit.rlim_cur = needed;
+	if ( setrlimit(RLIMIT_NOFILE, &limit) != 0 ) {
+		perror("setrlimit");
+		exit(1);
+	}
+}
+
+/**
+ * FUNCTION NAME: ENinit
+ *
+ * DESCRIPTION: Gives the node its id as in EmulNet, and a non-blocking UDP
+ * 				socket bound to a free port on 127.0.0.1
+ */
+void *UdpNet::ENinit(Address *myaddr, short port) {
+	EmulNet::ENinit(myaddr, port);
+	int id = *(int *)(myaddr->addr);
+	nodes.resize(id + 1);
+	udp_node &node = nodes[id];
+
+	node.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if ( node.fd < 0 ) {
+		perror("socket");
+		exit(1);
+	}
+	int rcvbuf = UDP_RCVBUF;
+	int on = 1;
+	setsockopt(node.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	setsockopt(node.fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+
+	memset(&node.addr, 0, sizeof(node.addr));
+	node.addr.sin_family = AF_INET;
+	node.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	node.addr.sin_port = 0;
+	socklen_t addrlen = sizeof(node.addr);
+	if ( bind(node.fd, (struct sockaddr *)&node.addr, sizeof(node.addr)) != 0 || getsockname(node.fd, (struct sockaddr *)&node.addr, &addrlen) != 0 ) {
+		perror("bind");
+		exit(1);
+	}
+	node.outstanding = 0;
+	node.overflows = 0;
+	return myaddr;
+}
+
+/**
+ * FUNCTION NAME: ENrecv
+ *
+ * DESCRIPTION: Drains the node's socket, UDP_BATCH datagrams per recvmmsg
+ * 				call, and hands every datagram to enq in the order it
+ * 				arrived. The data stays valid until it is passed to ENrelease.
+ * 				A node that has not released all of its last datagrams does
+ * 				not receive, and the new ones wait in its socket
+ *
+ * RETURN:
+ * 0
+ */
+int UdpNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue) {
+	static thread_local udp_batch batch;
+	int id = *(int *)(myaddr->addr);
+	if ( id <= 0 || id >= (int)nodes.size() ) {
+		return 0;
+	}
+	udp_node &node = nodes[id];
+	if ( node.outstanding > 0 ) {
+		return 0;
+	}
+
+	// the datagrams land in the thread's batch, and are packed into the
+	// node's arena, which only grows while the node's traffic does
+	node.arena.clear();
+	node.offsets.clear();
+	while ( true ) {
+		batch.prepare(par->MAX_MSG_SIZE);
+		int received = recvmmsg(node.fd, batch.msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		if ( received < 0 && errno == EINTR ) {
+			continue;
+		}
+		if ( received <= 0 ) {
+			break;
+		}
+		for ( int i = 0; i < received; i++ ) {
+			node.offsets.push_back(node.arena.size());
+			node.arena.insert(node.arena.end(), (char *)batch.iov[i].iov_base, (char *)batch.iov[i].iov_base + batch.msgs[i].msg_len);
+			struct cmsghdr *cmsg = CMSG_FIRSTHDR(&batch.msgs[i].msg_hdr);
+			if ( cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL ) {
+				memcpy(&node.overflows, CMSG_DATA(cmsg), sizeof(node.overflows));
+			}
+		}
+		if ( received < UDP_BATCH ) {
+			break;
+		}
+	}
+
+	int numReceived = node.offsets.size();
+	node.offsets.push_back(node.arena.size());
+	for ( int i = 0; i < numReceived; i++ ) {
+		(*enq)(queue, &node.arena[node.offsets[i]], node.offsets[i + 1] - node.offsets[i]);
+	}
+	node.outstanding = numReceived;
+
+	// increments the received message count for the destination node at the
+	// current time
+	ENcount(id, 0, numReceived);
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: ENrelease
+ *
+ * DESCRIPTION: The receiver is done with a datagram from ENrecv
+ */
+void UdpNet::ENrelease(Address *myaddr, char *buff) {
+	nodes[*(int *)(myaddr->addr)].outstanding--;
+}
+
+/**
+ * FUNCTION NAME: UDPsend
+ *
+ * DESCRIPTION: Sends what one node staged during the tick. A multicast is
+ * 				one datagram per destination, all of them pointing at the
+ * 				same staged bytes, and each with its own drop decision.
+ * 				Datagrams the kernel refuses are counted as dropped_full
+ */
+void UdpNet::UDPsend(int id, en_stage &nodeStage) {
+	sendIov.resize(nodeStage.sends.size());
+	sendMsgs.clear();
+
+	for ( size_t i = 0; i < nodeStage.sends.size(); i++ ) {
+		en_staged &send = nodeStage.sends[i];
+		sendIov[i].iov_base = &nodeStage.data[0] + send.offset;
+		sendIov[i].iov_len = send.size;
+		for ( int d = send.firstDest; d < send.firstDest + send.numDests; d++ ) {
+			if( ENdrop(send.size) ) {
+				continue;
+			}
+			int destId = nodeStage.dests[d].getid();
+			if ( destId <= 0 || destId >= (int)nodes.size() ) {
+				continue;
+			}
+			struct mmsghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_hdr.msg_name = &nodes[destId].addr;
+			msg.msg_hdr.msg_namelen = sizeof(nodes[destId].addr);
+			msg.msg_hdr.msg_iov = &sendIov[i];
+			msg.msg_hdr.msg_iovlen = 1;
+			sendMsgs.push_back(msg);
+		}
+	}
+
+	size_t done = 0;
+	while ( done < sendMsgs.size() ) {
+		int sent = sendmmsg(nodes[id].fd, &sendMsgs[done], min(sendMsgs.size() - done, (size_t)UDP_SEND_BATCH), 0);
+		if ( sent < 0 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			// the datagram at done was refused, carry on with the next one
+			full_drops++;
+			done++;
+			continue;
+		}
+		ENcount(id, sent, 0);
+		sent_messages += sent;
+		for ( int i = 0; i < sent; i++, done++ ) {
+			sent_bytes += sendMsgs[done].msg_hdr.msg_iov->iov_len;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: UDPflush
+ *
+ * DESCRIPTION: Sends what node id staged and empties its stage
+ */
+void UdpNet::UDPflush(int id) {
+	en_stage &nodeStage = stage[id];
+	if ( !nodeStage.sends.empty() ) {
+		UDPsend(id, nodeStage);
+	}
+	nodeStage.data.clear();
+	nodeStage.sends.clear();
+	nodeStage.dests.clear();
+}
+
+/**
+ * FUNCTION NAME: ENtick
+ *
+ * DESCRIPTION: Sends what the nodes staged during the tick, node after node
+ * 				from the highest id down as in EmulNet
+ */
+void UdpNet::ENtick() {
+	for ( int id = (int)stage.size() - 1; id > 0; id-- ) {
+		UDPflush(id);
+	}
+
+	ENflushCounts();
+}
+
+/**
+ * FUNCTION NAME: ENsocket
+ *
+ * DESCRIPTION: The node's socket, for callers that wait on it
+ */
+int UdpNet::ENsocket(Address *myaddr) {
+	return nodes[*(int *)(myaddr->addr)].fd;
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Sends what one node staged right away instead of at the end
+ * 				of the tick, for callers that step nodes one at a time
+ */
+void UdpNet::ENflush(Address *myaddr) {
+	UDPflush(*(int *)(myaddr->addr));
+}
+
+/**
+ * FUNCTION NAME: ENcleanup
+ *
+ * DESCRIPTION: Closes every socket and writes msgcount.log as EmulNet does.
+ * 				Datagrams the kernel dropped for lack of receive buffer space
+ * 				are counted as dropped_full
+ */
+int UdpNet::ENcleanup() {
+	for ( vector<udp_node>::iterator node = nodes.begin(); node != nodes.end(); ++node ) {
+		if ( node->fd >= 0 ) {
+			full_drops += node->overflows;
+			close(node->fd);
+			node->fd = -1;
+		}
+	}
+	return EmulNet::ENcleanup();
+}
@@ -0,0 +1,82 @@
+/**********************************
+ * FILE NAME: UdpNet.h
+ *
+ * DESCRIPTION: Header file of UdpNet class
+ **********************************/
+
+#ifndef _UDPNET_H_
+#define _UDPNET_H_
+
+#include "stdincludes.h"
+#include "EmulNet.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/*
+ * Macros
+ */
+// datagrams taken from a socket per recvmmsg call
+#define UDP_BATCH 64
+// the most datagrams sendmmsg takes per call, the kernel's UIO_MAXIOV
+#define UDP_SEND_BATCH 1024
+// receive buffer asked for on every socket, the kernel caps it at
+// net.core.rmem_max
+#define UDP_RCVBUF (4 * 1024 * 1024)
+// file descriptors kept free for the logs and the standard streams
+#define UDP_SPARE_FDS 32
+
+/**
+ * Struct Name: udp_node
+ *
+ * DESCRIPTION: The socket of one node and what it last received
+ */
+typedef struct udp_node {
+	int fd;
+	struct sockaddr_in addr;
+	// datagrams of the last ENrecv, back to back, and where each one starts
+	vector<char> arena;
+	vector<int> offsets;
+	// of those, the ones not handed back through ENrelease yet
+	int outstanding;
+	// datagrams the kernel dropped because the receive buffer was full, as
+	// last reported by SO_RXQ_OVFL
+	unsigned int overflows;
+}udp_node;
+
+/**
+ * CLASS NAME: UdpNet
+ *
+ * DESCRIPTION: EmulNet over real UDP sockets on 127.0.0.1, one non-blocking
+ * 				socket per node on a port picked by the kernel. Sends are
+ * 				staged exactly as in EmulNet and go out at the end of the tick,
+ * 				each node's with as few sendmmsg calls as possible, in the same
+ * 				node order. ENrecv drains the node's socket with recvmmsg. The
+ * 				drop decisions of MSG_DROP_PROB are taken as in EmulNet, so
+ * 				runs match the emulated network as long as no socket buffer
+ * 				overflows
+ */
+class UdpNet : public EmulNet {
+private:
+	// indexed by node id
+	vector<udp_node> nodes;
+	// sendmmsg arguments for one node, kept to avoid allocating every tick
+	vector<struct iovec> sendIov;
+	vector<struct mmsghdr> sendMsgs;
+	void UDPraiseFileLimit();
+	void UDPsend(int id, en_stage &nodeStage);
+	void UDPflush(int id);
+	UdpNet(const UdpNet &anotherUdpNet);
+	UdpNet& operator = (const UdpNet &anotherUdpNet);
+public:
+	UdpNet(Params *p);
+	virtual ~UdpNet();
+	void *ENinit(Address *myaddr, short port);
+	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	void ENrelease(Address *myaddr, char *buff);
+	void ENtick();
+	int ENcleanup();
+	int ENsocket(Address *myaddr);
+	void ENflush(Address *myaddr);
+};
+
+#endif /* _UDPNET_H_ */
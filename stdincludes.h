@@ -19,6 +19,7 @@
  */
 #include <stdio.h>
 #include <math.h>
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -31,10 +32,16 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <algorithm>
 #include <queue>
 #include <fstream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 using namespace std;
 